@@ -1,6 +1,8 @@
 (() => {
   const BUILD_TAG = '2026-04-20';
   const STORAGE_KEY = 'suminagashi.settings.v2';
+  // sizeof(DropRecord) in app.h: f32 x, y, radius, u32 0xRRGGBBAA.
+  const DROP_RECORD_BYTES = 16;
   const QUALITY_LEVELS = [
     { id: 0, name: 'Performance', scale: 0.75 },
     { id: 1, name: 'Balanced', scale: 0.9 },
@@ -241,7 +243,7 @@
     }
 
     el.statusText.textContent = state.mode === 'tine'
-      ? 'Tine mode: click to carve'
+      ? 'Tine mode: drag to carve'
       : state.mode === 'random'
         ? 'Random mode: click to place a random color drop'
         : 'Ready to create';
@@ -426,6 +428,68 @@
     scheduleLayoutSync('clear');
   }
 
+  // Add many drops in one native call, e.g. for generated patterns. `drops`
+  // is an array of { x, y, radius, color: [r, g, b, a] } in canvas pixels,
+  // oldest first. Returns the number of drops added.
+  function insertDrops(drops) {
+    if (!Array.isArray(drops) || drops.length === 0) {
+      return 0;
+    }
+    if (!hasNativeExport('insertDrops') || !hasNativeExport('malloc')) {
+      showToast('Batch insertion is not available in this build', 'error');
+      return 0;
+    }
+
+    const ptr = Module._malloc(drops.length * DROP_RECORD_BYTES);
+    if (!ptr) {
+      return 0;
+    }
+    try {
+      // Take the views after malloc: memory growth replaces them.
+      const floats = Module.HEAPF32;
+      const words = Module.HEAPU32;
+      drops.forEach((drop, index) => {
+        const base = (ptr >> 2) + index * 4;
+        const [r = 255, g = 255, b = 255, a = 255] = drop.color || [];
+        floats[base] = drop.x;
+        floats[base + 1] = drop.y;
+        floats[base + 2] = drop.radius;
+        words[base + 3] = (((r & 255) << 24) | ((g & 255) << 16) | ((b & 255) << 8) | (a & 255)) >>> 0;
+      });
+      const inserted = callNative('insertDrops', 'number', ['number', 'number'], [ptr, drops.length]) || 0;
+      log('inserted drops', { requested: drops.length, inserted });
+      return inserted;
+    } finally {
+      Module._free(ptr);
+    }
+  }
+
+  // Pull a comb through the canvas in one native call, e.g. for gel-git or
+  // chevron passes. Coordinates are canvas pixels; angle is in degrees, 90
+  // pulling down. Strength and sharpness default to the tine sliders.
+  function applyRake({ x, y, angle = 90, tines = 40, spacing = 30, strength, sharpness } = {}) {
+    if (!hasNativeExport('applyRake')) {
+      showToast('Rakes are not available in this build', 'error');
+      return;
+    }
+    const push = strength ?? Number.parseFloat(el.strengthSlider?.value || '0');
+    const band = sharpness ?? Number.parseFloat(el.sharpnessSlider?.value || '1');
+    const centerX = x ?? (el.canvas?.width || 0) / 2;
+    const centerY = y ?? (el.canvas?.height || 0) / 2;
+    callNative('applyRake', null, ['number', 'number', 'number', 'number', 'number', 'number', 'number'],
+      [centerX, centerY, angle, tines, spacing, push, band]);
+  }
+
+  // Step back or forward over whole actions (a drop, a stroke, a rake, an
+  // insertDrops batch). Returns true if the canvas changed.
+  function undo() {
+    return callNative('undo', 'number', [], []) === 1;
+  }
+
+  function redo() {
+    return callNative('redo', 'number', [], []) === 1;
+  }
+
   function fitCanvas() {
     scheduleLayoutSync('fit');
     showToast('Canvas layout synced', 'success');
@@ -524,6 +588,18 @@
       let pointerDown = false;
       let lastX = -9999;
       const minDelta = 4;
+      // Stroke samples since the last flush, as canvas x, y pairs; the first
+      // pair is where the previous flush ended.
+      let strokePoints = [];
+      let strokeFrame = 0;
+
+      function canvasPoint(event) {
+        const rect = el.canvas.getBoundingClientRect();
+        return [
+          (event.clientX - rect.left) * (el.canvas.width / rect.width),
+          (event.clientY - rect.top) * (el.canvas.height / rect.height)
+        ];
+      }
 
       function invokeTine(clientX) {
         if (state.mode !== 'tine') {
@@ -537,6 +613,45 @@
         callNative('applyTineAt', null, ['number', 'number', 'number'], [canvasX, strength, sharpness]);
       }
 
+      // Send the samples gathered this frame as one polyline, so a fast drag
+      // costs one native call per frame however many events it fired.
+      function flushStroke() {
+        strokeFrame = 0;
+        const count = strokePoints.length / 2;
+        if (count < 2 || state.mode !== 'tine') {
+          return;
+        }
+        const ptr = Module._malloc(strokePoints.length * 4);
+        if (!ptr) {
+          return;
+        }
+        try {
+          Module.HEAPF32.set(strokePoints, ptr >> 2);
+          const strength = Number.parseFloat(el.strengthSlider?.value || '0');
+          const sharpness = Number.parseFloat(el.sharpnessSlider?.value || '1');
+          callNative('applyTineStroke', null, ['number', 'number', 'number', 'number'], [ptr, count, strength, sharpness]);
+        } finally {
+          Module._free(ptr);
+        }
+        strokePoints = strokePoints.slice(-2);
+      }
+
+      function addStrokePoint(event) {
+        const [x, y] = canvasPoint(event);
+        const n = strokePoints.length;
+        if (n >= 2 && Math.abs(x - strokePoints[n - 2]) + Math.abs(y - strokePoints[n - 1]) < 1) {
+          return;
+        }
+        strokePoints.push(x, y);
+        if (!strokeFrame) {
+          strokeFrame = requestAnimationFrame(flushStroke);
+        }
+      }
+
+      function hasStrokeExport() {
+        return hasNativeExport('applyTineStroke') && hasNativeExport('malloc');
+      }
+
       el.canvas.addEventListener('mousedown', event => {
         if (event.button !== 0) {
           return;
@@ -544,7 +659,11 @@
 
         pointerDown = true;
         lastX = -9999;
-        invokeTine(event.clientX);
+        if (state.mode === 'tine' && hasStrokeExport()) {
+          strokePoints = canvasPoint(event);
+        } else {
+          invokeTine(event.clientX);
+        }
       });
       window.addEventListener('mouseup', () => { pointerDown = false; });
       el.canvas.addEventListener('mousemove', event => {
@@ -552,6 +671,10 @@
           return;
         }
 
+        if (state.mode === 'tine' && hasStrokeExport()) {
+          addStrokePoint(event);
+          return;
+        }
         const rect = el.canvas.getBoundingClientRect();
         const x = (event.clientX - rect.left) * (el.canvas.width / rect.width);
         if (Math.abs(x - lastX) >= minDelta) {
@@ -563,6 +686,18 @@
     }
 
     window.addEventListener('keydown', event => {
+      if (event.ctrlKey || event.metaKey) {
+        const key = event.key.toLowerCase();
+        if (key === 'z' || key === 'y') {
+          event.preventDefault();
+          if (key === 'y' || event.shiftKey) {
+            redo();
+          } else {
+            undo();
+          }
+        }
+        return;
+      }
       if (event.key === 't' || event.key === 'T') {
         setMode(state.mode === 'drops' ? 'tine' : 'drops');
       }
@@ -671,6 +806,10 @@
 
   function exposeGlobals() {
     window.clearCanvas = clearCanvas;
+    window.insertDrops = insertDrops;
+    window.applyRake = applyRake;
+    window.undo = undo;
+    window.redo = redo;
     window.saveScreenshot = saveScreenshot;
     window.toggleFullscreen = toggleFullscreen;
     window.showInfo = showInfo;
@@ -1,23 +1,104 @@
 #include "drops.h"
+#include "drop_store.h"
+#include "marble_kernel.h"
 
-Drop::Drop(float x, float y, color clr, double radius, int n)
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+
+static_assert(std::is_trivially_destructible_v<Drop>, "DropStore::Clear relies on Drop being trivially destructible");
+
+namespace
 {
-    this->clr = clr;
+// cos then sin of 2*pi*i/n for i in [0, n), shared by every drop created
+// with n vertices. Doubles, so outlines come out exactly as when each
+// constructor evaluated cos/sin itself.
+const double* UnitCircle(int n)
+{
+    static std::mutex mutex;
+    static std::unordered_map<int, std::unique_ptr<double[]>> tables;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<double[]>& table = tables[n];
+    if (!table)
+    {
+        table.reset(new double[2 * (size_t)n]);
+        for (int i = 0; i < n; ++i)
+        {
+            const double angle = (2.0 * PI * i) / (double)n;
+            table[i] = cos(angle);
+            table[n + i] = sin(angle);
+        }
+    }
+    return table.get();
+}
+
+// Accumulated far-field stretch after which an outline is resampled even if
+// no exact op touched it.
+constexpr float kFarFieldRemeshStretch = 1.05f;
+// Samples of the rake falloff table over one band.
+constexpr int kRakeFalloffSteps = 256;
+} // namespace
+
+Drop::Drop(DropStore& store, float x, float y, color clr, double radius, int n)
+{
+    this->clr = PackColor(clr);
     center = {(float)x, (float)y};
     this->radius = radius;
     this->n = n;
+    this->store = &store;
+    compact = store.IsCompact();
+    stride = DropStore::StrideFor(n);
+    offset = store.Allocate(stride);
     // Generate exactly n distinct perimeter vertices (no duplicated closing vertex).
     // The old version used i <= n which duplicated the first point at the end;
     // that duplicate produced a degenerate triangle in the fan triangulation
     // after heavy marble distortions, showing up visually as a "wedge"/flat flap.
-    vertices.reserve(n);
-    baseVertices.reserve(n);
+    float* xs = curX();
+    float* ys = curY();
+    const double* unit = UnitCircle(n);
+    for (int i = 0; i < n; ++i)
+    {
+        xs[i] = (float)(center.x + unit[i] * radius);
+        ys[i] = (float)(center.y + unit[n + i] * radius);
+    }
+    commitBase();
+    refreshShape(false);
+}
+
+float* Drop::curX() const
+{
+    return store->Block(offset);
+}
+
+void Drop::refreshShape(bool recenter)
+{
+    ++revision;
+    if (n <= 0)
+        return;
+    const float* xs = curX();
+    const float* ys = curY();
+    double accx = 0.0, accy = 0.0;
+    float minX = xs[0], maxX = xs[0], minY = ys[0], maxY = ys[0];
     for (int i = 0; i < n; ++i)
     {
-        double angle = (2.0 * PI * i) / (double)n;
-        Vector2 v{(float)(center.x + cos(angle) * radius), (float)(center.y + sin(angle) * radius)};
-        vertices.push_back(v);
-        baseVertices.push_back(v);
+        accx += xs[i];
+        accy += ys[i];
+        minX = fminf(minX, xs[i]);
+        maxX = fmaxf(maxX, xs[i]);
+        minY = fminf(minY, ys[i]);
+        maxY = fmaxf(maxY, ys[i]);
+    }
+    bounds = {minX, minY, maxX - minX, maxY - minY};
+    if (recenter)
+    {
+        // Recompute center as polygon centroid so later radial-based effects (noise, animate)
+        // remain well-behaved; a stale center caused uneven stretching and apparent wedges
+        // in triangle-fan rendering.
+        center.x = (float)(accx / n);
+        center.y = (float)(accy / n);
+        polarValid = false;
     }
 }
 
@@ -26,6 +107,7 @@ void Drop::updateColor(float step)
 {
     if (!hasTarget)
         return;
+    ++revision;
     if (step < 0)
         step = 0;
     if (step > 0.2f)
@@ -40,10 +122,10 @@ void Drop::updateColor(float step)
     // Lerp between startClr and targetClr by blendAccum
     auto lerpComp = [](int a, int b, float t)
     { return (int)(a + (b - a) * t); };
-    clr.r = lerpComp(startClr.r, targetClr.r, blendAccum);
-    clr.g = lerpComp(startClr.g, targetClr.g, blendAccum);
-    clr.b = lerpComp(startClr.b, targetClr.b, blendAccum);
-    clr.a = lerpComp(startClr.a, targetClr.a, blendAccum);
+    const color from = UnpackColor(startClr);
+    const color to = UnpackColor(targetClr);
+    clr = PackColor(color(lerpComp(from.r, to.r, blendAccum), lerpComp(from.g, to.g, blendAccum),
+                          lerpComp(from.b, to.b, blendAccum), lerpComp(from.a, to.a, blendAccum)));
     // Stop updating when fully reached maxBlend plateau
     if (blendAccum >= maxBlend - 0.0001f)
     {
@@ -51,10 +133,12 @@ void Drop::updateColor(float step)
     }
 }
 
-void Drop::Draw_drops()
+void Drop::Draw_drops() const
 {
-    Color raylibColor = {static_cast<unsigned char>(clr.r), static_cast<unsigned char>(clr.g), static_cast<unsigned char>(clr.b), static_cast<unsigned char>(clr.a)};
-    size_t realCount = vertices.size();
+    Color raylibColor = {static_cast<unsigned char>(clr >> 24), static_cast<unsigned char>(clr >> 16), static_cast<unsigned char>(clr >> 8), static_cast<unsigned char>(clr)};
+    const float* xs = curX();
+    const float* ys = curY();
+    size_t realCount = (size_t)n;
     rlBegin(RL_TRIANGLES);
     rlColor4ub(raylibColor.r, raylibColor.g, raylibColor.b, raylibColor.a);
     // Triangle fan (center, v[i], v[i+1]) over n distinct vertices (convex assumption)
@@ -64,111 +148,195 @@ void Drop::Draw_drops()
         // If winding is wrong triangles will be culled (nothing visible) in WebGL.
         for (size_t i = 0; i < realCount; ++i)
         {
-            const Vector2 &a = vertices[i];
-            const Vector2 &b = vertices[(i + 1) % realCount];
+            const size_t j = (i + 1) % realCount;
             // Flip a/b order from previous version to fix winding.
             rlVertex2f(center.x, center.y);
-            rlVertex2f(b.x, b.y);
-            rlVertex2f(a.x, a.y);
+            rlVertex2f(xs[j], ys[j]);
+            rlVertex2f(xs[i], ys[i]);
         }
     }
 
     rlEnd();
 
-    // for (size_t i = 1; i < realCount; ++i) DrawLineV(vertices[i-1], vertices[i], WHITE);
+    // for (size_t i = 1; i < realCount; ++i) DrawLineV({xs[i-1], ys[i-1]}, {xs[i], ys[i]}, WHITE);
 }
 void Drop::update_vertices(float c_x, float c_y, double n_r)
 {
+    ++revision;
+    float* xs = curX();
+    float* ys = curY();
     this->center.x = c_x + ((this->center.x - c_x) * sqrt(1 + (n_r * n_r / ((this->center.x - c_x) * (this->center.x - c_x)))));
     this->center.y = c_y + ((this->center.y - c_y) * sqrt(1 + (n_r * n_r / ((this->center.y - c_y) * (this->center.y - c_y)))));
-    for (size_t i = 0; i < vertices.size(); ++i)
+    polarValid = false;
+    for (int i = 0; i < n; ++i)
     {
-        vertices[i].x = c_x + ((vertices[i].x - c_x) * sqrt(1 + (n_r * n_r / ((vertices[i].x - c_x) * (vertices[i].x - c_x)))));
-        vertices[i].y = c_y + ((vertices[i].y - c_y) * sqrt(1 + (n_r * n_r / ((vertices[i].y - c_y) * (vertices[i].y - c_y)))));
+        xs[i] = c_x + ((xs[i] - c_x) * sqrt(1 + (n_r * n_r / ((xs[i] - c_x) * (xs[i] - c_x)))));
+        ys[i] = c_y + ((ys[i] - c_y) * sqrt(1 + (n_r * n_r / ((ys[i] - c_y) * (ys[i] - c_y)))));
     }
 }
 
 void Drop::wavy_transformation()
 {
-    for (size_t i = 0; i < vertices.size(); ++i)
+    ++revision;
+    float* xs = curX();
+    float* ys = curY();
+    for (int i = 0; i < n; ++i)
     {
-        double angle = (2.0 * PI * i) / (vertices.size() - 1);
+        double angle = (2.0 * PI * i) / (n - 1);
         double wave = 4 * sin(10 * angle); // amplitude 10, frequency 5
-        vertices[i].x += wave * cos(angle);
-        vertices[i].y += wave * sin(angle);
+        xs[i] += wave * cos(angle);
+        ys[i] += wave * sin(angle);
     }
 }
 void Drop::inserve_wavy_transformation()
 {
-    for (size_t i = 0; i < vertices.size(); ++i)
+    ++revision;
+    float* xs = curX();
+    float* ys = curY();
+    for (int i = 0; i < n; ++i)
     {
-        double angle = (2.0 * PI * i) / (vertices.size() - 1);
+        double angle = (2.0 * PI * i) / (n - 1);
         double wave = 10 * sin(5 * angle); // amplitude 10, frequency 5
-        vertices[i].x -= wave * cos(angle);
-        vertices[i].y -= wave * sin(angle);
+        xs[i] -= wave * cos(angle);
+        ys[i] -= wave * sin(angle);
     }
 }
 
 void Drop::marble(const Drop &other, bool commitBaseShape)
 {
-    Vector2 c = other.center;
-    float r = (float)other.radius;
     // Original formula mapped radial distance m to sqrt(m^2 + r^2). It was
     // implemented as m * sqrt(1 + r^2/m^2) which blows up (NaN/Inf) when m~0
     // and produced a single overly stretched / stuck vertex ("triangle" wing).
-    // Re-write directly with soft clamping for very small m to keep the
-    // deformation smooth and bounded.
-    const float EPS = 1e-6f;      // avoid divide-by-zero
-    const float MAX_SCALE = 6.0f; // tighter safety cap against extreme stretching
-    for (size_t i = 0; i < vertices.size(); ++i)
-    {
-        Vector2 p = vertices[i];
-        float dx = p.x - c.x;
-        float dy = p.y - c.y;
-        float m2 = dx * dx + dy * dy;
-        if (m2 < EPS)
+    // The kernels use a smoother rational mapping m + r^2/(m + r) with a soft
+    // scale clamp; see marble_kernel.h.
+    MarbleVerticesSimd(curX(), curY(), (size_t)n, other.center.x, other.center.y, (float)other.radius);
+    refreshShape(true);
+    if (commitBaseShape)
+        commitBase(); // refresh base for later noise/animation
+}
+
+bool Drop::applyOps(const MarbleOp* ops, size_t count, float farFieldTolerance)
+{
+    MarbleSource sources[64];
+    bool reshaped = false;
+    size_t i = 0;
+    while (i < count)
+    {
+        if (ops[i].kind == MarbleOp::VerticalTine)
         {
-            // Vertex sits (almost) on the other drop's center; push it outward
-            // along an arbitrary stable direction (keep current) by radius r.
-            // (Rare unless centers coincide.)
-            float invLen = 1.0f / sqrtf(EPS);
-            dx *= invLen;
-            dy *= invLen;
-            p.x = c.x + dx * r;
-            p.y = c.y + dy * r;
-            vertices[i] = p;
+            applyVerticalTine(ops[i].x, ops[i].strength, ops[i].sharpness, true);
+            reshaped = true;
+            ++i;
             continue;
         }
-        float m = sqrtf(m2);
-        // Smoother mapping than sqrt(m^2 + r^2): gives gentler gradient near m=0
-        // newDist in [min(r, m), ...] without abrupt clustering that created a flat chord.
-        float newDist = m + (r * r) / (m + r); // rational smoothing
-        float scale = newDist / m;
-        if (scale > MAX_SCALE)
-            scale = MAX_SCALE; // clamp extreme cases
-        // Small angular jitter to keep two adjacent vertices from collapsing exactly
-        float ang = atan2f(dy, dx);
-        float jitter = 0.0005f * r;                                 // tiny, frame-independent
-        p.x = c.x + (dx * scale) + cosf(ang + 1.5707963f) * jitter; // perpendicular nudge
-        p.y = c.y + (dy * scale) + sinf(ang + 1.5707963f) * jitter;
-        vertices[i] = p;
-    }
-    // Recompute center as polygon centroid so later radial-based effects (noise, animate)
-    // remain well-behaved; a stale center caused uneven stretching and apparent wedges
-    // in triangle-fan rendering.
-    if (!vertices.empty())
-    {
-        double accx = 0.0, accy = 0.0;
-        for (auto &v : vertices)
+        if (ops[i].kind == MarbleOp::Rake)
         {
-            accx += v.x;
-            accy += v.y;
+            applyRake(ops[i]);
+            reshaped = true;
+            ++i;
+            continue;
         }
-        center.x = (float)(accx / vertices.size());
-        center.y = (float)(accy / vertices.size());
+        if (ops[i].kind == MarbleOp::TineSegment)
+        {
+            size_t run = 1;
+            while (i + run < count && ops[i + run].kind == MarbleOp::TineSegment)
+                ++run;
+            applyTineSegments(ops + i, run);
+            reshaped = true;
+            i += run;
+            continue;
+        }
+        if (farFieldTolerance > 0.0f)
+        {
+            const size_t far = applyFarField(ops + i, count - i, farFieldTolerance);
+            if (far > 0)
+            {
+                i += far;
+                continue;
+            }
+        }
+        size_t run = 0;
+        float reach = 0.0f;
+        while (i < count && ops[i].kind == MarbleOp::DropInsert && run < 64)
+        {
+            // Leave far sources to the affine path; the run so far can move
+            // the outline by at most `reach`.
+            if (run > 0 && farFieldTolerance > 0.0f && isFarFrom(ops[i], reach, farFieldTolerance))
+            {
+                break;
+            }
+            sources[run++] = {ops[i].x, ops[i].y, ops[i].radius};
+            reach += MarbleDisplacementBound(ops[i].radius);
+            ++i;
+        }
+        MarbleVerticesFusedSimd(curX(), curY(), (size_t)n, sources, run);
+        refreshShape(true);
+        commitBase();
+        reshaped = true;
     }
-    if (commitBaseShape)
-        baseVertices = vertices; // refresh base for later noise/animation
+    // Far-field maps are near-rigid; resample only once they may have
+    // stretched edges noticeably.
+    return reshaped || farStretch > kFarFieldRemeshStretch;
+}
+
+bool Drop::isFarFrom(const MarbleOp& op, float slack, float tolerance) const
+{
+    MarbleLinearization linear;
+    return MarbleLinearize({op.x, op.y, op.radius}, bounds.x - slack, bounds.y - slack, bounds.x + bounds.width + slack,
+                           bounds.y + bounds.height + slack, linear) &&
+           linear.error <= tolerance;
+}
+
+size_t Drop::applyFarField(const MarbleOp* ops, size_t count, float tolerance)
+{
+    // Each source is linearized over the box the outline can occupy after
+    // the sources before it: the bounds moved by the map so far, grown by the
+    // error so far. Errors of earlier maps are stretched by later ones at
+    // most by their Lipschitz bound.
+    MarbleAffine total;
+    float error = 0.0f;
+    float stretch = 1.0f;
+    float minX = bounds.x, minY = bounds.y;
+    float maxX = bounds.x + bounds.width, maxY = bounds.y + bounds.height;
+    size_t far = 0;
+    while (far < count && ops[far].kind == MarbleOp::DropInsert)
+    {
+        MarbleLinearization linear;
+        if (!MarbleLinearize({ops[far].x, ops[far].y, ops[far].radius}, minX - error, minY - error, maxX + error, maxY + error, linear))
+            break;
+        const float nextError = error * linear.lipschitz + linear.error;
+        if (nextError > tolerance)
+            break;
+        total = ComposeAffine(linear.map, total);
+        error = nextError;
+        stretch *= linear.lipschitz;
+        ++far;
+
+        const float cornersX[4] = {bounds.x, bounds.x + bounds.width, bounds.x, bounds.x + bounds.width};
+        const float cornersY[4] = {bounds.y, bounds.y, bounds.y + bounds.height, bounds.y + bounds.height};
+        for (int k = 0; k < 4; ++k)
+        {
+            const float x = total.a * cornersX[k] + total.b * cornersY[k] + total.tx;
+            const float y = total.c * cornersX[k] + total.d * cornersY[k] + total.ty;
+            minX = k == 0 ? x : fminf(minX, x);
+            maxX = k == 0 ? x : fmaxf(maxX, x);
+            minY = k == 0 ? y : fminf(minY, y);
+            maxY = k == 0 ? y : fmaxf(maxY, y);
+        }
+    }
+    if (far == 0)
+        return 0;
+    // One pass for vertices and bounds; the centroid of an affine image is
+    // the image of the centroid, so refreshShape's pass is not needed.
+    float box[4];
+    TransformVertices(curX(), curY(), (size_t)n, total, box);
+    bounds = {box[0], box[1], box[2] - box[0], box[3] - box[1]};
+    center = {total.a * center.x + total.b * center.y + total.tx, total.c * center.x + total.d * center.y + total.ty};
+    polarValid = false;
+    ++revision;
+    commitBase();
+    farStretch *= stretch;
+    return far;
 }
 
 // ---- Continuous 2D value noise helpers (smooth, stable over time) ----
@@ -204,87 +372,187 @@ static float valueNoise2D(float x, float y)
     return ix0 + (ix1 - ix0) * sy; // 0..1
 }
 
-void Drop::applyEdgeNoise(float amplitude, float frequency, float time)
+void Drop::ensurePolar()
 {
-    // Uses 2D value noise over (angle * frequency, time * temporalScale) for smooth evolution.
-    if (baseVertices.size() != vertices.size())
-        baseVertices = vertices; // fallback sync
-    float amp = (float)radius * amplitude;
-    const float temporalScale = 0.35f; // speed factor for animation
-    for (size_t i = 0; i < vertices.size(); ++i)
+    if (polarValid)
+        return;
+    const float* baseXs = baseX();
+    const float* baseYs = baseY();
+    float* angle = polarAngle();
+    float* dist = polarRadius();
+    float* cosA = polarCos();
+    float* sinA = polarSin();
+    for (int i = 0; i < n; ++i)
     {
-        if (i >= baseVertices.size())
-            break;
-        Vector2 base = baseVertices[i];
-        float dx = base.x - center.x;
-        float dy = base.y - center.y;
-        float ang = atan2f(dy, dx); // -PI..PI
-        // Normalize angle to 0..1 before feeding to noise (optional)
-        float angNorm = (ang + PI) / (2.0f * PI); // 0..1
-        float n = valueNoise2D(angNorm * frequency, time * temporalScale);
-        n = n * 2.0f - 1.0f; // map to -1..1
-        float r = sqrtf(dx * dx + dy * dy);
-        float nr = r + n * amp;
-        vertices[i].x = center.x + cosf(ang) * nr;
-        vertices[i].y = center.y + sinf(ang) * nr;
+        const float dx = baseXs[i] - center.x;
+        const float dy = baseYs[i] - center.y;
+        const float r = sqrtf(dx * dx + dy * dy);
+        angle[i] = atan2f(dy, dx); // -PI..PI
+        dist[i] = r;
+        // A vertex on the center has no direction; atan2 gives 0 there.
+        cosA[i] = r > 0.0f ? dx / r : 1.0f;
+        sinA[i] = r > 0.0f ? dy / r : 0.0f;
     }
+    polarValid = true;
 }
 
 void Drop::blendColor(const color &target, float t)
 {
+    ++revision;
     if (t < 0)
         t = 0;
     if (t > 1)
         t = 1;
-    clr.r = (int)(clr.r + (target.r - clr.r) * t);
-    clr.g = (int)(clr.g + (target.g - clr.g) * t);
-    clr.b = (int)(clr.b + (target.b - clr.b) * t);
-    clr.a = (int)(clr.a + (target.a - clr.a) * t);
+    const color c = UnpackColor(clr);
+    clr = PackColor(color((int)(c.r + (target.r - c.r) * t), (int)(c.g + (target.g - c.g) * t),
+                          (int)(c.b + (target.b - c.b) * t), (int)(c.a + (target.a - c.a) * t)));
 }
 
-void Drop::animateShape(float time, float amplitude, float speed, int harmonics)
+// ---- Fused deformation pipeline ----
+// Each enabled effect adds a radial offset to the cached base radius; the
+// vertex is then placed once along the cached direction. Kernels are
+// instantiated per effect set and harmonics count, so the loop body has no
+// branches and the harmonics loop is fully unrolled.
+namespace
 {
-    if (baseVertices.size() != vertices.size())
-        baseVertices = vertices;
-    float amp = (float)radius * amplitude;
-    if (harmonics < 1)
-        harmonics = 1;
-    if (harmonics > 5)
-        harmonics = 5; // limit
-    for (size_t i = 0; i < vertices.size(); ++i)
-    {
-        Vector2 base = baseVertices[i];
-        float dx = base.x - center.x;
-        float dy = base.y - center.y;
-        float ang = atan2f(dy, dx);
-        float r = sqrtf(dx * dx + dy * dy);
-        float deform = 0.0f;
-        for (int h = 1; h <= harmonics; ++h)
+constexpr int kMaxHarmonics = 5;
+constexpr float kNoiseTemporalScale = 0.35f; // speed factor for noise animation
+
+struct DeformStreams
+{
+    float* xs;
+    float* ys;
+    const float* angle;
+    const float* dist;
+    const float* cosA;
+    const float* sinA;
+    int n;
+    float cx, cy;
+};
+
+struct DeformConstants
+{
+    float noiseAmp;   // pixels
+    float noiseScale; // frequency / 2pi, applied to angle + pi
+    float noiseY;
+    // sin(h*ang + phase_h) = sin(h*ang) cos(phase_h) + cos(h*ang) sin(phase_h),
+    // with 1/h and amp/harmonics folded into both factors.
+    float phaseCos[kMaxHarmonics];
+    float phaseSin[kMaxHarmonics];
+};
+
+template <bool Noise, bool Ripple, int Harmonics>
+void DeformPass(const DeformStreams& s, const DeformConstants& k)
+{
+    for (int i = 0; i < s.n; ++i)
+    {
+        const float c1 = s.cosA[i];
+        const float s1 = s.sinA[i];
+        float r = s.dist[i];
+        if constexpr (Noise)
         {
-            deform += (sinf(ang * h + time * speed * (0.4f + h * 0.2f)) / h);
+            r += (valueNoise2D((s.angle[i] + PI) * k.noiseScale, k.noiseY) * 2.0f - 1.0f) * k.noiseAmp;
         }
-        deform *= (amp / harmonics);
-        float nr = r + deform;
-        vertices[i].x = center.x + cosf(ang) * nr;
-        vertices[i].y = center.y + sinf(ang) * nr;
+        if constexpr (Ripple)
+        {
+            // sin/cos(h*ang) by the angle-addition recurrence.
+            float ch = c1, sh = s1;
+            for (int h = 0; h < Harmonics; ++h)
+            {
+                r += sh * k.phaseCos[h] + ch * k.phaseSin[h];
+                const float next = ch * c1 - sh * s1;
+                sh = sh * c1 + ch * s1;
+                ch = next;
+            }
+        }
+        s.xs[i] = s.cx + c1 * r;
+        s.ys[i] = s.cy + s1 * r;
     }
 }
 
-void Drop::commitBase()
+using DeformFn = void (*)(const DeformStreams&, const DeformConstants&);
+
+template <bool Noise, bool Ripple>
+constexpr DeformFn kDeformByHarmonics[kMaxHarmonics] = {
+    DeformPass<Noise, Ripple, 1>, DeformPass<Noise, Ripple, 2>, DeformPass<Noise, Ripple, 3>,
+    DeformPass<Noise, Ripple, 4>, DeformPass<Noise, Ripple, 5>};
+
+DeformFn SelectDeform(bool noise, bool ripple, int harmonics)
 {
-    baseVertices = vertices;
+    const int h = harmonics - 1;
+    if (noise)
+        return ripple ? kDeformByHarmonics<true, true>[h] : kDeformByHarmonics<true, false>[0];
+    return ripple ? kDeformByHarmonics<false, true>[h] : kDeformByHarmonics<false, false>[0];
 }
+} // namespace
 
-void Drop::resetToBase()
+void Drop::deform(const DropAnimation& animation)
 {
-    if (!baseVertices.empty() && baseVertices.size() == vertices.size())
+    if (compact)
+        return;
+    ++revision;
+    ensurePolar();
+    const DeformStreams streams{curX(), curY(), polarAngle(), polarRadius(), polarCos(), polarSin(),
+                                n, center.x, center.y};
+    int harmonics = animation.harmonics;
+    if (harmonics < 1)
+        harmonics = 1;
+    if (harmonics > kMaxHarmonics)
+        harmonics = kMaxHarmonics; // limit
+    DeformConstants k{};
+    k.noiseAmp = (float)radius * animation.noiseAmplitude;
+    k.noiseScale = animation.noiseFrequency / (2.0f * PI);
+    k.noiseY = animation.time * kNoiseTemporalScale;
+    const float rippleAmp = (float)radius * animation.rippleAmplitude;
+    for (int h = 1; h <= harmonics; ++h)
     {
-        vertices = baseVertices;
+        const float phase = animation.time * animation.rippleSpeed * (0.4f + h * 0.2f);
+        const float weight = rippleAmp / (harmonics * (float)h);
+        k.phaseCos[h - 1] = cosf(phase) * weight;
+        k.phaseSin[h - 1] = sinf(phase) * weight;
     }
+    SelectDeform(animation.noiseAmplitude != 0.0f, animation.rippleAmplitude != 0.0f, harmonics)(streams, k);
+}
+
+void Drop::applyEdgeNoise(float amplitude, float frequency, float time)
+{
+    DropAnimation animation;
+    animation.time = time;
+    animation.noiseAmplitude = amplitude;
+    animation.noiseFrequency = frequency;
+    deform(animation);
+}
+
+void Drop::animateShape(float time, float amplitude, float speed, int harmonics)
+{
+    DropAnimation animation;
+    animation.time = time;
+    animation.rippleAmplitude = amplitude;
+    animation.rippleSpeed = speed;
+    animation.harmonics = harmonics;
+    deform(animation);
+}
+
+void Drop::commitBase()
+{
+    ++baseRevision;
+    ++revision;
+    polarValid = false;
+    // Current x/y and base x/y streams are adjacent, so one copy moves both.
+    if (!compact)
+        std::memcpy(baseX(), curX(), sizeof(float) * 2 * stride);
+}
+
+void Drop::resetToBase()
+{
+    ++revision;
+    if (!compact)
+        std::memcpy(curX(), baseX(), sizeof(float) * 2 * stride);
 }
 
 void Drop::applyVerticalTine(float x, float strength, float sharpness, bool commitBase)
 {
+    ++revision;
     // Robust, smooth vertical tine deformation.
     // Requirements:
     //  * Maximum downward translation at the vertex whose x is closest to mouse x.
@@ -306,31 +574,36 @@ void Drop::applyVerticalTine(float x, float strength, float sharpness, bool comm
     if (R < minR) R = minR;
     if (R > maxR) R = maxR;
 
+    // Drops whose bounds miss the influence band are untouched; skip the
+    // vertex passes entirely.
+    if (bounds.x > x + R || bounds.x + bounds.width < x - R) return;
+
     // Power to control edge softness: higher -> sharper center, softer edge.
     // Map original sharpness to exponent in [1,3].
-    float weightExp = 1.0f + fminf(fmaxf(sharpness, 1.0f), 512.0f) / 256.0f * 2.0f; // 1..3
+    float weightExp = TineExponent(sharpness); // 1..3
 
     // Pre-pass: find vertex closest in x to anchor for potential center adjustment.
     int closestIdx = -1; float closestDx = 1e9f;
-    for (size_t i = 0; i < vertices.size(); ++i) {
-        float dx = fabsf(vertices[i].x - x);
+    float* xs = curX();
+    float* ys = curY();
+    const float* baseYs = baseY();
+    const size_t count = (size_t)n;
+    for (size_t i = 0; i < count; ++i) {
+        float dx = fabsf(xs[i] - x);
         if (dx < closestDx) { closestDx = dx; closestIdx = (int)i; }
     }
 
     if (closestIdx == -1) return;
 
     // Capture original y for optional smoothing.
-    std::vector<float> origY;
-    origY.reserve(vertices.size());
-    for (auto &v : vertices) origY.push_back(v.y);
+    std::vector<float> origY(ys, ys + count);
 
     float totalDelta = 0.0f; int affected = 0;
     // Diminishing returns control: limit cumulative displacement relative to local radius
     float localMax = strength; // base cap per stroke center
     float cumulativeCap = fmaxf((float)radius * 0.65f, strength * 1.2f); // absolute max allowed downward shift from original base for any vertex
-    for (size_t i = 0; i < vertices.size(); ++i) {
-        Vector2 &v = vertices[i];
-        float dx = fabsf(v.x - x);
+    for (size_t i = 0; i < count; ++i) {
+        float dx = fabsf(xs[i] - x);
         if (dx >= R) continue; // outside influence
         float u = dx / R; // 0..1
         // Quintic smoothstep S(u)
@@ -340,49 +613,476 @@ void Drop::applyVerticalTine(float x, float strength, float sharpness, bool comm
         if (weightExp != 1.0f) w = powf(fmaxf(w, 0.0f), weightExp);
         if (w < 1e-4f) continue;
         float disp = strength * w; // proposed downward shift this stroke
-        // Diminishing returns: reduce disp if vertex already moved a lot relative to its base (if available)
-        if (baseVertices.size() == vertices.size()) {
-            float already = v.y - baseVertices[i].y; // positive if moved downward
-            if (already > 0) {
-                // Soft approach to cap: remaining fraction = 1 - (already / cumulativeCap)
-                float remaining = 1.0f - (already / cumulativeCap);
-                if (remaining <= 0.0f) continue; // saturated
-                // Ease remaining fraction (quintic) to avoid sudden clamp
-                float rem2 = remaining * remaining; float rem3 = rem2 * remaining;
-                float eased = rem3 * (remaining * (remaining * 6.0f - 15.0f) + 10.0f);
-                disp *= eased;
-            }
+        // Diminishing returns: reduce disp if vertex already moved a lot relative to its base
+        float already = ys[i] - baseYs[i]; // positive if moved downward
+        if (already > 0) {
+            // Soft approach to cap: remaining fraction = 1 - (already / cumulativeCap)
+            float remaining = 1.0f - (already / cumulativeCap);
+            if (remaining <= 0.0f) continue; // saturated
+            // Ease remaining fraction (quintic) to avoid sudden clamp
+            float rem2 = remaining * remaining; float rem3 = rem2 * remaining;
+            float eased = rem3 * (remaining * (remaining * 6.0f - 15.0f) + 10.0f);
+            disp *= eased;
         }
         // Additionally fade very small residuals
         if (fabsf(disp) < 0.0005f) continue;
-        v.y += disp;
+        ys[i] += disp;
         totalDelta += disp;
         ++affected;
     }
 
     // Mild localized Laplacian smoothing inside influence band to avoid a sharp "ridge" at center.
-    if (affected > 3 && vertices.size() > 4) {
+    if (affected > 3 && count > 4) {
         const float smoothFactor = 0.25f; // 0..0.5 safe
         std::vector<float> newY = origY; // start from original for consistency
-        for (size_t i = 0; i < vertices.size(); ++i) {
-            float dx = fabsf(vertices[i].x - x);
-            if (dx >= R) { newY[i] = vertices[i].y; continue; }
-            const Vector2 &prev = vertices[(i + vertices.size() - 1) % vertices.size()];
-            const Vector2 &next = vertices[(i + 1) % vertices.size()];
-            float avg = (prev.y + vertices[i].y + next.y) / 3.0f;
-            newY[i] = vertices[i].y * (1.0f - smoothFactor) + avg * smoothFactor;
+        for (size_t i = 0; i < count; ++i) {
+            float dx = fabsf(xs[i] - x);
+            if (dx >= R) { newY[i] = ys[i]; continue; }
+            float prevY = ys[(i + count - 1) % count];
+            float nextY = ys[(i + 1) % count];
+            float avg = (prevY + ys[i] + nextY) / 3.0f;
+            newY[i] = ys[i] * (1.0f - smoothFactor) + avg * smoothFactor;
         }
-        for (size_t i = 0; i < vertices.size(); ++i) {
-            float dx = fabsf(vertices[i].x - x);
-            if (dx < R) vertices[i].y = newY[i];
+        for (size_t i = 0; i < count; ++i) {
+            float dx = fabsf(xs[i] - x);
+            if (dx < R) ys[i] = newY[i];
         }
     }
 
     // Adjust stored center.y gently based on average displacement (keeps animations coherent).
     if (affected > 0) {
         center.y += (totalDelta / (float)affected) * 0.2f; // small bias only
+        polarValid = false;
+        refreshShape(false);
     }
 
     if (commitBase)
-        baseVertices = vertices;
+        this->commitBase();
+}
+
+void Drop::applyTineSegments(const MarbleOp* ops, size_t count)
+{
+    struct Segment
+    {
+        float ax, ay, mx, my, length, strength, band, ramp, exponent;
+    };
+    // Keep the segments whose band or ramp can reach the outline. Earlier
+    // segments of the run may have moved it by up to `slack` towards later
+    // ones.
+    static thread_local std::vector<Segment> segments;
+    segments.clear();
+    float slack = 0.0f;
+    for (size_t k = 0; k < count; ++k)
+    {
+        const MarbleOp& op = ops[k];
+        const float dx = op.x1 - op.x;
+        const float dy = op.y1 - op.y;
+        const float length = sqrtf(dx * dx + dy * dy);
+        if (length < 1e-4f || fabsf(op.strength) < 1e-5f)
+            continue;
+        const float band = TineBand(op.sharpness);
+        const float ramp = TineRamp(band, op.strength);
+        const float reach = ramp + slack;
+        if (fminf(op.x, op.x1) - reach > bounds.x + bounds.width || fmaxf(op.x, op.x1) + reach < bounds.x ||
+            fminf(op.y, op.y1) - reach > bounds.y + bounds.height || fmaxf(op.y, op.y1) + reach < bounds.y)
+            continue;
+        segments.push_back({op.x, op.y, dx / length, dy / length, length, op.strength, band, ramp, TineExponent(op.sharpness)});
+        slack += fabsf(op.strength);
+    }
+    if (segments.empty() || n <= 0)
+        return;
+
+    auto smooth = [](float u)
+    {
+        u = fminf(fmaxf(u, 0.0f), 1.0f);
+        return u * u * u * (u * (u * 6.0f - 15.0f) + 10.0f);
+    };
+    float* xs = curX();
+    float* ys = curY();
+    const size_t vertexCount = (size_t)n;
+    static thread_local std::vector<float> moveX, moveY;
+    moveX.assign(vertexCount, 0.0f);
+    moveY.assign(vertexCount, 0.0f);
+    bool moved = false;
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        float x = xs[i];
+        float y = ys[i];
+        for (const Segment& s : segments)
+        {
+            const float px = x - s.ax;
+            const float py = y - s.ay;
+            const float t = px * s.mx + py * s.my;
+            const float d = fabsf(py * s.mx - px * s.my);
+            if (d >= s.band || t <= -s.ramp || t >= s.length + s.ramp)
+                continue;
+            // The quintic can overshoot 1 by an ulp near the band edge.
+            float w = fmaxf(1.0f - smooth(d / s.band), 0.0f);
+            if (s.exponent != 1.0f)
+                w = powf(w, s.exponent);
+            const float span = 2.0f * s.ramp;
+            const float window = smooth((t + s.ramp) / span) - smooth((t - s.length + s.ramp) / span);
+            const float disp = s.strength * w * window;
+            x += disp * s.mx;
+            y += disp * s.my;
+        }
+        moveX[i] = x - xs[i];
+        moveY[i] = y - ys[i];
+        moved |= moveX[i] != 0.0f || moveY[i] != 0.0f;
+    }
+    if (!moved)
+        return;
+
+    // One smoothing step for the whole run. Unlike the vertical tine, which
+    // smooths positions, this smooths the displacement: ridges at the band
+    // edge soften, a drop the stroke carries whole moves without shrinking,
+    // and no vertex moves further than the segments pushed any vertex.
+    const float smoothFactor = 0.25f;
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        float mx = moveX[i];
+        float my = moveY[i];
+        if (vertexCount > 4)
+        {
+            const size_t prev = (i + vertexCount - 1) % vertexCount;
+            const size_t next = (i + 1) % vertexCount;
+            mx += ((moveX[prev] + moveX[next] + mx) / 3.0f - mx) * smoothFactor;
+            my += ((moveY[prev] + moveY[next] + my) / 3.0f - my) * smoothFactor;
+        }
+        xs[i] += mx;
+        ys[i] += my;
+    }
+    refreshShape(true);
+    commitBase();
+}
+
+bool Drop::remesh(const RemeshParams& params, bool* needsGrow)
+{
+    farStretch = 1.0f;
+    if (n < 3)
+        return false;
+    const float* xs = curX();
+    const float* ys = curY();
+    const float minEdge2 = params.minEdge * params.minEdge;
+    const float maxEdge2 = params.maxEdge * params.maxEdge;
+
+    // Pass 1: decimate. Vertex 0 is always kept; a later vertex j is dropped
+    // when it is closer than minEdge to the last kept vertex, or when it lies
+    // within `flatness` of the chord from the last kept vertex to j+1 and that
+    // chord is still short enough not to need subdividing again.
+    static thread_local std::vector<int> kept;
+    kept.clear();
+    kept.push_back(0);
+    for (int j = 1; j < n; ++j)
+    {
+        const int k = kept.back();
+        const int next = (j + 1) % n;
+        const float ax = xs[j] - xs[k];
+        const float ay = ys[j] - ys[k];
+        if (ax * ax + ay * ay < minEdge2)
+            continue;
+        const float cx = xs[next] - xs[k];
+        const float cy = ys[next] - ys[k];
+        const float chord2 = cx * cx + cy * cy;
+        if (chord2 <= maxEdge2 && chord2 > 1e-12f)
+        {
+            // Distance from vertex j to the chord k -> next.
+            const float cross = ax * cy - ay * cx;
+            if (cross * cross < params.flatness * params.flatness * chord2)
+                continue;
+        }
+        kept.push_back(j);
+    }
+    if ((int)kept.size() < params.minVertices)
+    {
+        // Too aggressive for this outline (tiny or nearly degenerate drop);
+        // keep everything and only subdivide.
+        kept.resize(n);
+        for (int i = 0; i < n; ++i)
+            kept[i] = i;
+    }
+
+    // Pass 2: size the subdivision. Long chords get evenly spaced linear
+    // inserts; the edge limit is relaxed if the result would blow the budget.
+    // Inserts are counted in float and capped per chord, so a chord stretched
+    // without bound cannot overflow the count; the uncapped float sum still
+    // drives the relaxation.
+    const int keptCount = (int)kept.size();
+    float edgeLimit = params.maxEdge;
+    auto insertsFor = [&](float len)
+    {
+        return len > edgeLimit ? (int)fminf(ceilf(len / edgeLimit) - 1.0f, (float)params.maxVertices) : 0;
+    };
+    int64_t total = 0;
+    for (int attempt = 0; attempt < 4; ++attempt)
+    {
+        total = keptCount;
+        float wanted = (float)keptCount;
+        for (int i = 0; i < keptCount; ++i)
+        {
+            const int a = kept[i];
+            const int b = kept[(i + 1) % keptCount];
+            const float len = hypotf(xs[b] - xs[a], ys[b] - ys[a]);
+            total += insertsFor(len);
+            if (len > edgeLimit)
+                wanted += ceilf(len / edgeLimit) - 1.0f;
+        }
+        if (total <= params.maxVertices)
+            break;
+        edgeLimit *= wanted / (float)params.maxVertices;
+    }
+    if (total == n && keptCount == n)
+        return false; // nothing to merge or split
+
+    static thread_local std::vector<float> outX, outY;
+    outX.clear();
+    outY.clear();
+    outX.reserve((size_t)total);
+    outY.reserve((size_t)total);
+    for (int i = 0; i < keptCount; ++i)
+    {
+        const int a = kept[i];
+        const int b = kept[(i + 1) % keptCount];
+        outX.push_back(xs[a]);
+        outY.push_back(ys[a]);
+        const int pieces = insertsFor(hypotf(xs[b] - xs[a], ys[b] - ys[a])) + 1;
+        for (int p = 1; p < pieces; ++p)
+        {
+            const float t = (float)p / (float)pieces;
+            outX.push_back(xs[a] + (xs[b] - xs[a]) * t);
+            outY.push_back(ys[a] + (ys[b] - ys[a]) * t);
+        }
+    }
+
+    // Move to a block of the new size. Allocation may grow the pool, so the
+    // old pointers above are not used past this point. A smaller outline
+    // keeps the front of its block and hands the tail back to the store.
+    const int newCount = (int)outX.size();
+    const uint32_t newStride = DropStore::StrideFor(newCount);
+    if (newStride > stride)
+    {
+        if (needsGrow)
+        {
+            *needsGrow = true;
+            return false;
+        }
+        store->Free(offset, stride);
+        offset = store->Allocate(newStride);
+        stride = newStride;
+    }
+    else if (newStride < stride)
+    {
+        store->Free(offset + newStride * store->StreamsPerDrop(), stride - newStride);
+        stride = newStride;
+    }
+    n = newCount;
+    std::memcpy(curX(), outX.data(), sizeof(float) * n);
+    std::memcpy(curY(), outY.data(), sizeof(float) * n);
+    commitBase();
+    refreshShape(false);
+    return true;
+}
+
+float Drop::inscribedRadius() const
+{
+    if (n < 3)
+        return 0.0f;
+    const float* xs = curX();
+    const float* ys = curY();
+    // Even-odd point-in-polygon test for the center, and the smallest
+    // distance from the center to any edge in the same sweep.
+    bool inside = false;
+    float minDist2 = 1e30f;
+    for (int i = 0, j = n - 1; i < n; j = i++)
+    {
+        const float ax = xs[j], ay = ys[j];
+        const float bx = xs[i], by = ys[i];
+        if ((by > center.y) != (ay > center.y) &&
+            center.x < ax + (bx - ax) * (center.y - ay) / (by - ay))
+            inside = !inside;
+        const float ex = bx - ax, ey = by - ay;
+        const float len2 = ex * ex + ey * ey;
+        float t = len2 > 0.0f ? ((center.x - ax) * ex + (center.y - ay) * ey) / len2 : 0.0f;
+        t = fminf(fmaxf(t, 0.0f), 1.0f);
+        const float dx = ax + ex * t - center.x;
+        const float dy = ay + ey * t - center.y;
+        minDist2 = fminf(minDist2, dx * dx + dy * dy);
+    }
+    return inside ? sqrtf(minDist2) : 0.0f;
+}
+
+bool Drop::containsPoint(Vector2 p) const
+{
+    if (n < 3 || p.x < bounds.x || p.y < bounds.y || p.x > bounds.x + bounds.width || p.y > bounds.y + bounds.height)
+        return false;
+    const float* xs = baseX();
+    const float* ys = baseY();
+    bool inside = false;
+    for (int i = 0, j = n - 1; i < n; j = i++)
+    {
+        if ((ys[i] > p.y) != (ys[j] > p.y) &&
+            p.x < xs[j] + (xs[i] - xs[j]) * (p.y - ys[j]) / (ys[i] - ys[j]))
+            inside = !inside;
+    }
+    return inside;
+}
+
+float Drop::farthestVertexFrom(Vector2 p) const
+{
+    const float* xs = curX();
+    const float* ys = curY();
+    float maxDist2 = 0.0f;
+    for (int i = 0; i < n; ++i)
+    {
+        const float dx = xs[i] - p.x;
+        const float dy = ys[i] - p.y;
+        maxDist2 = fmaxf(maxDist2, dx * dx + dy * dy);
+    }
+    return sqrtf(maxDist2);
+}
+
+void Drop::retire()
+{
+    if (retired)
+        return;
+    store->Free(offset, stride);
+    retired = true;
+    ++revision;
+    n = 0;
+    stride = 0;
+}
+
+void Drop::restore(const Drop& saved, const float* xs, const float* ys)
+{
+    if (saved.retired)
+    {
+        retire();
+    }
+    else
+    {
+        const uint32_t need = DropStore::StrideFor(saved.n);
+        if (retired || stride < need)
+        {
+            if (!retired)
+                store->Free(offset, stride);
+            offset = store->Allocate(need);
+            stride = need;
+            retired = false;
+        }
+        std::memcpy(curX(), xs, sizeof(float) * saved.n);
+        std::memcpy(curY(), ys, sizeof(float) * saved.n);
+    }
+    center = saved.center;
+    radius = saved.radius;
+    clr = saved.clr;
+    n = saved.n;
+    farStretch = saved.farStretch;
+    bounds = saved.bounds;
+    opCursor = saved.opCursor;
+    targetClr = saved.targetClr;
+    hasTarget = saved.hasTarget;
+    startClr = saved.startClr;
+    blendAccum = saved.blendAccum;
+    maxBlend = saved.maxBlend;
+    if (retired)
+        ++revision;
+    else
+        commitBase();
+}
+
+void Drop::applyRake(const MarbleOp& op)
+{
+    const float spacing = op.spacing;
+    if (op.tines == 0 || spacing <= 0.0f || fabsf(op.strength) < 1e-5f || n <= 0)
+        return;
+    // Pull direction m and the across-comb axis nx, ny. Tine k sits at
+    // offset first + k * spacing along the axis.
+    const float mx = op.x1;
+    const float my = op.y1;
+    const float nx = -my;
+    const float ny = mx;
+    const float band = TineBand(op.sharpness);
+    const float exponent = TineExponent(op.sharpness);
+    const int lastTine = static_cast<int>(op.tines) - 1;
+    const float first = op.x * nx + op.y * ny - 0.5f * spacing * static_cast<float>(lastTine);
+
+    // Skip drops whose bounds project entirely outside the comb.
+    const float cornerX[2] = {bounds.x, bounds.x + bounds.width};
+    const float cornerY[2] = {bounds.y, bounds.y + bounds.height};
+    float lo = 1e30f, hi = -1e30f;
+    for (float cx : cornerX)
+    {
+        for (float cy : cornerY)
+        {
+            const float u = cx * nx + cy * ny;
+            lo = fminf(lo, u);
+            hi = fmaxf(hi, u);
+        }
+    }
+    if (hi < first - band || lo > first + spacing * static_cast<float>(lastTine) + band)
+        return;
+
+    // The falloff (1 - S(t))^e sampled once per exponent and thread, so the
+    // per-tine work is a table lookup instead of a powf. Linear
+    // interpolation over 256 steps is within 1e-4 of the curve.
+    struct Falloff
+    {
+        float exponent = -1.0f;
+        float table[kRakeFalloffSteps + 2];
+    };
+    static thread_local Falloff falloff;
+    if (falloff.exponent != exponent)
+    {
+        for (int j = 0; j <= kRakeFalloffSteps; ++j)
+        {
+            const float t = static_cast<float>(j) / kRakeFalloffSteps;
+            falloff.table[j] = powf(fmaxf(1.0f - t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f), 0.0f), exponent);
+        }
+        falloff.table[kRakeFalloffSteps + 1] = 0.0f;
+        falloff.exponent = exponent;
+    }
+
+    float* xs = curX();
+    float* ys = curY();
+    const size_t vertexCount = (size_t)n;
+    const float inverseSpacing = 1.0f / spacing;
+    const float tableScale = kRakeFalloffSteps / band;
+    static thread_local std::vector<float> push;
+    push.assign(vertexCount, 0.0f);
+    bool moved = false;
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        const float u = xs[i] * nx + ys[i] * ny - first;
+        const int kBegin = std::max(0, static_cast<int>(ceilf((u - band) * inverseSpacing)));
+        const int kEnd = std::min(lastTine, static_cast<int>(floorf((u + band) * inverseSpacing)));
+        float sum = 0.0f;
+        for (int k = kBegin; k <= kEnd; ++k)
+        {
+            const float t = fminf(fabsf(u - spacing * static_cast<float>(k)) * tableScale, static_cast<float>(kRakeFalloffSteps));
+            const int j = static_cast<int>(t);
+            const float f = t - static_cast<float>(j);
+            sum += falloff.table[j] + (falloff.table[j + 1] - falloff.table[j]) * f;
+        }
+        push[i] = op.strength * sum;
+        moved |= sum > 0.0f;
+    }
+    if (!moved)
+        return;
+
+    // One smoothing step on the push, as for tine segments.
+    const float smoothFactor = 0.25f;
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        float p = push[i];
+        if (vertexCount > 4)
+        {
+            const size_t prev = (i + vertexCount - 1) % vertexCount;
+            const size_t next = (i + 1) % vertexCount;
+            p += ((push[prev] + push[next] + p) / 3.0f - p) * smoothFactor;
+        }
+        xs[i] += p * mx;
+        ys[i] += p * my;
+    }
+    refreshShape(true);
+    commitBase();
 }
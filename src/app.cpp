@@ -1,10 +1,14 @@
 #include "app.h"
 
+#include "job_system.h"
+#include "event_log.h"
 #include "screenshot.h"
 
 #include <algorithm>
 #include <cmath>
+#include <initializer_list>
 #include <iostream>
+#include <random>
 
 namespace
 {
@@ -13,15 +17,44 @@ constexpr int kDefaultWidth = 1200;
 constexpr int kDefaultHeight = 800;
 constexpr int kMinDropRadius = 5;
 constexpr int kMaxDropRadius = 400;
-constexpr int kFpsLow = 40;
-constexpr int kFpsHigh = 60;
-constexpr int kVertexMin = 200;
-constexpr int kVertexMax = 600;
-constexpr int kVertexStep = 10;
+// Vertices of a new drop at full detail, and the floor when the frame
+// budget controller scales detail down.
+constexpr int kBaseVertices = 400;
+constexpr int kMinVertices = 64;
+// Outline spacing for drops inserted in batches, in px.
+constexpr float kBatchVertexSpacing = 2.0f;
+// A native tine drag records a segment once the mouse has moved this far
+// (Manhattan, px), so a slow drag does not log a segment per frame.
+constexpr float kMinStrokeStep = 2.0f;
+// Drops resampled per frame after a detail change, so a sweep over 10k
+// drops finishes in well under a second without a single long frame.
+constexpr size_t kRetessellateBatch = 256;
+constexpr float kEdgeNoiseAmplitude = 0.16f;
+constexpr float kRippleAmplitude = 0.12f;
+// Furthest a per-frame deformation can move a vertex, as a fraction of radius.
+constexpr float kDeformMargin = kEdgeNoiseAmplitude + kRippleAmplitude;
+// Visible drops per deformation job.
+constexpr size_t kDeformGrain = 8;
+// A count-triggered bake brings the live drops down to this fraction of the
+// limit, and age-triggered bakes wait for a batch or this interval, so
+// evictions (which shift the renderer's buffer) stay rare.
+constexpr float kBakeLowWater = 0.75f;
+constexpr size_t kMinBakeBatch = 32;
+constexpr double kMinBakeInterval = 2.0;
+// Frame stats overlay: graph window and scale.
+constexpr size_t kStatsGraphFrames = 120;
+constexpr int kStatsGraphHeight = 60;
+constexpr float kStatsGraphMs = 33.3f;
+const Color kStatsPhaseColors[FrameStats::kPhaseCount] = {DARKGREEN, ORANGE, PURPLE, BLUE, GRAY};
 
 SuminagashiApp* gApp = nullptr;
 
-color PickRandomPaletteColor()
+int RandomIndex(std::mt19937& rng, size_t count)
+{
+    return static_cast<int>(std::uniform_int_distribution<size_t>(0, count - 1)(rng));
+}
+
+color PickRandomPaletteColor(std::mt19937& rng)
 {
     const auto& palettes = ColorPalette::getAllPalettes();
     if (palettes.empty())
@@ -29,17 +62,23 @@ color PickRandomPaletteColor()
         return color(255, 255, 255, 255);
     }
 
-    const int paletteIndex = GetRandomValue(0, static_cast<int>(palettes.size()) - 1);
+    const int paletteIndex = RandomIndex(rng, palettes.size());
     const auto& palette = palettes[static_cast<size_t>(paletteIndex)];
     if (palette.empty())
     {
         return color(255, 255, 255, 255);
     }
 
-    const int colorIndex = GetRandomValue(0, static_cast<int>(palette.size()) - 1);
+    const int colorIndex = RandomIndex(rng, palette.size());
     const auto& colorValue = palette[static_cast<size_t>(colorIndex)];
     return color(colorValue[0], colorValue[1], colorValue[2], colorValue[3]);
 }
+
+// JS callers can pass NaN or Infinity; such ops are neither applied nor logged.
+bool AllFinite(std::initializer_list<float> values)
+{
+    return std::all_of(values.begin(), values.end(), [](float value) { return std::isfinite(value); });
+}
 } // namespace
 
 SuminagashiApp& GetApp()
@@ -54,7 +93,55 @@ SuminagashiApp& GetApp()
 SuminagashiApp::SuminagashiApp()
     : nextDropColor(255, 255, 255, 255)
 {
+    // Every random pick of the session comes from this seed, which the event
+    // log records.
+    const uint32_t seed = std::random_device{}();
+    rng.seed(seed);
+    eventLog.Reset(seed);
+    colorGenerator.setCurrentPaletteIndex(static_cast<size_t>(RandomIndex(rng, colorGenerator.getPaletteCount())));
     EnsureDefaultNextDropColor();
+    ApplyDetailLevel(false);
+}
+
+float SuminagashiApp::SessionTime() const
+{
+    return static_cast<float>(GetTime() - sessionStart);
+}
+
+void SuminagashiApp::RecordQuality()
+{
+    SceneEvent event;
+    event.type = SceneEvent::Quality;
+    event.time = SessionTime();
+    event.quality = static_cast<int>(qualityMode);
+    eventLog.Append(event);
+    recordedDetailLevel = 0;
+}
+
+void SuminagashiApp::RecordDetail()
+{
+    SceneEvent event;
+    event.type = SceneEvent::Detail;
+    event.time = SessionTime();
+    event.level = frameBudget.Level();
+    eventLog.Append(event);
+    recordedDetailLevel = event.level;
+}
+
+void SuminagashiApp::RecordResolvePoint(SceneEvent event)
+{
+    event.time = SessionTime();
+    eventLog.AppendIfChanged(event);
+}
+
+void SuminagashiApp::RecordViewport()
+{
+    SceneEvent event;
+    event.type = SceneEvent::Viewport;
+    event.time = SessionTime();
+    event.width = GetScreenWidth();
+    event.height = GetScreenHeight();
+    eventLog.Append(event);
 }
 
 QualityMode SuminagashiApp::ClampQualityMode(int mode)
@@ -84,6 +171,11 @@ float SuminagashiApp::QualityScaleForMode(QualityMode mode)
     }
 }
 
+RemeshParams SuminagashiApp::RemeshParamsForMode(QualityMode mode)
+{
+    return RemeshParamsForQuality(static_cast<int>(mode));
+}
+
 void SuminagashiApp::Initialize()
 {
     SetConfigFlags(FLAG_VSYNC_HINT | FLAG_WINDOW_RESIZABLE | FLAG_MSAA_4X_HINT);
@@ -97,12 +189,18 @@ void SuminagashiApp::Initialize()
     metrics.qualityScale = QualityScaleForMode(qualityMode);
     EnsureDefaultNextDropColor();
     LogCanvasMetrics("init");
+    sessionStart = GetTime();
+    RecordQuality();
+    RecordViewport();
 }
 
 void SuminagashiApp::Shutdown()
 {
     if (IsWindowReady())
     {
+        renderer.Unload();
+        bakedLayer.Unload();
+        pixelEngine.Unload();
         CloseWindow();
     }
 }
@@ -119,7 +217,47 @@ void SuminagashiApp::EnsureDefaultNextDropColor()
 
 void SuminagashiApp::HandleInput()
 {
-    if (!IsMouseButtonPressed(MOUSE_LEFT_BUTTON) || interactionMode == 1)
+#if !defined(__EMSCRIPTEN__)
+    // Ctrl+Z undoes, Ctrl+Shift+Z or Ctrl+Y redoes. On the web, app.js binds
+    // the same keys.
+    if (IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL))
+    {
+        const bool shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+        if (IsKeyPressed(KEY_Z))
+        {
+            shift ? Redo() : Undo();
+        }
+        else if (IsKeyPressed(KEY_Y))
+        {
+            Redo();
+        }
+    }
+#endif
+    if (interactionMode == 1)
+    {
+#if !defined(__EMSCRIPTEN__)
+        // Tine mode: the drag so far becomes one stroke segment per frame.
+        // On the web, app.js batches pointer samples into applyTineStroke.
+        const Vector2 mouse = GetMousePosition();
+        if (!IsMouseButtonDown(MOUSE_LEFT_BUTTON))
+        {
+            tineDragging = false;
+        }
+        else if (!tineDragging)
+        {
+            tineDragging = true;
+            tineLast = mouse;
+        }
+        else if (fabsf(mouse.x - tineLast.x) + fabsf(mouse.y - tineLast.y) >= kMinStrokeStep)
+        {
+            const Vector2 segment[2] = {tineLast, mouse};
+            ApplyTineStroke(segment, 2, tineStrength, tineSharpness);
+            tineLast = mouse;
+        }
+#endif
+        return;
+    }
+    if (!IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
     {
         return;
     }
@@ -129,36 +267,92 @@ void SuminagashiApp::HandleInput()
     color dropColor = nextDropColor;
     if (interactionMode == 2)
     {
-        dropColor = PickRandomPaletteColor();
+        dropColor = PickRandomPaletteColor(rng);
     }
 
-    Drop drop(static_cast<float>(mouseX), static_cast<float>(mouseY), dropColor, nextDropRadius, currentN);
-
+    SceneEvent event;
+    event.type = SceneEvent::Drop;
+    event.time = SessionTime();
+    event.x = static_cast<float>(mouseX);
+    event.y = static_cast<float>(mouseY);
+    event.radius = static_cast<float>(nextDropRadius);
+    event.vertices = currentN;
+    event.rgba = PackColor(dropColor);
+    color targetColor;
     if (interactionMode == 0)
     {
         const auto& palette = colorGenerator.getCurrentPalette();
         if (palette.size() > 1)
         {
-            const int pick = GetRandomValue(0, static_cast<int>(palette.size()) - 1);
+            const int pick = RandomIndex(rng, palette.size());
             const auto& selected = palette[static_cast<size_t>(pick)];
-            drop.setTargetColor(color(selected[0], selected[1], selected[2], selected[3]), 0.4f);
+            targetColor = color(selected[0], selected[1], selected[2], selected[3]);
+            event.targetBlend = 0.4f;
         }
     }
     else if (interactionMode == 2)
     {
-        drop.setTargetColor(PickRandomPaletteColor(), 0.45f);
+        targetColor = PickRandomPaletteColor(rng);
+        event.targetBlend = 0.45f;
     }
+    event.targetRgba = PackColor(targetColor);
 
-    for (auto& existingDrop : drops)
+    // Recording the drop is O(1): older drops pick up its marble displacement
+    // lazily, when they are next resolved for drawing.
+    BeginAction();
+    Drop& drop = scene.AddDrop(event.x, event.y, dropColor, nextDropRadius, currentN);
+    if (event.targetBlend >= 0.0f)
     {
-        existingDrop.marble(drop, true);
+        drop.setTargetColor(targetColor, event.targetBlend);
     }
+    dropBirth.push_back(GetTime());
+    eventLog.Append(event);
+}
+
+size_t SuminagashiApp::InsertDrops(const DropRecord* records, size_t count)
+{
+    // Each drop is an O(1) op append, as for clicks. Older drops replay the
+    // whole batch in one fused pass when they are next resolved, instead of
+    // one pass per inserted drop.
+    const double now = GetTime();
+    const float time = SessionTime();
+    size_t inserted = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const DropRecord& record = records[i];
+        if (!std::isfinite(record.x) || !std::isfinite(record.y) || !std::isfinite(record.radius))
+        {
+            continue;
+        }
+        const float radius = std::clamp(record.radius, static_cast<float>(kMinDropRadius), static_cast<float>(kMaxDropRadius));
+        // Vertices follow the circumference instead of currentN: a batch is
+        // replayed in one go, so small drops would carry hundreds of
+        // vertices through it before their first remesh.
+        const int vertices = std::clamp(static_cast<int>(2.0f * PI * radius / kBatchVertexSpacing), kMinVertices, currentN);
 
-    drops.push_back(drop);
-    (void)mouseY;
+        SceneEvent event;
+        event.type = SceneEvent::Drop;
+        event.time = time;
+        event.x = record.x;
+        event.y = record.y;
+        event.radius = radius;
+        event.vertices = vertices;
+        event.rgba = record.rgba;
+        if (inserted == 0)
+        {
+            // The whole batch is one undo step, opened by its first valid
+            // record so an empty or rejected batch leaves no step behind.
+            BeginAction();
+        }
+        scene.AddDrop(event.x, event.y, UnpackColor(record.rgba), radius, vertices);
+        dropBirth.push_back(now);
+        eventLog.Append(event);
+        ++inserted;
+    }
+    return inserted;
 }
 
-void SuminagashiApp::UpdateAdaptiveVertexCount(float fps)
+void SuminagashiApp::UpdateFrameBudget(float fps)
 {
     fpsHistory[static_cast<size_t>(fpsIndex)] = fps;
     fpsIndex = (fpsIndex + 1) % static_cast<int>(fpsHistory.size());
@@ -170,25 +364,192 @@ void SuminagashiApp::UpdateAdaptiveVertexCount(float fps)
     }
     averageFps = total / static_cast<float>(fpsHistory.size());
 
-    if (averageFps < kFpsLow && currentN > kVertexMin)
+    // Judge the last complete frame: the app's own phases against the
+    // budget, and the whole frame for anything the laps do not see.
+    float workMs = 0.0f;
+    for (size_t phase = 0; phase < static_cast<size_t>(FramePhase::Present); ++phase)
     {
-        currentN = std::max(kVertexMin, currentN - kVertexStep);
+        workMs += frameStats.Sample(phase, 0);
     }
-    if (averageFps > kFpsHigh && currentN < kVertexMax)
+    const float frameMs = frameStats.Sample(FrameStats::kPhaseCount, 0);
+    if (frameStats.SampleCount() > 0 && frameBudget.AddFrame(GetTime(), workMs, frameMs))
     {
-        currentN = std::min(kVertexMax, currentN + kVertexStep);
+        ApplyDetailLevel(true);
+        std::cout << "[budget] detail " << frameBudget.Detail() << " (level " << frameBudget.Level()
+                  << ", frame " << frameMs << " ms, work " << workMs << " ms)" << std::endl;
     }
 }
 
+void SuminagashiApp::ApplyDetailLevel(bool retessellate)
+{
+    const float detail = frameBudget.Detail();
+    scene.SetRemeshParams(ScaleRemeshDetail(RemeshParamsForMode(qualityMode), detail));
+    currentN = std::max(kMinVertices, static_cast<int>(static_cast<float>(kBaseVertices) * detail + 0.5f));
+    if (frameBudget.Level() != recordedDetailLevel)
+    {
+        RecordDetail();
+    }
+    if (retessellate)
+    {
+        retessellateCursor = 0;
+    }
+}
+
+void SuminagashiApp::ContinueRetessellation()
+{
+    if (retessellateCursor >= scene.Drops().Size())
+    {
+        retessellateCursor = SIZE_MAX;
+        return;
+    }
+    scene.RemeshRange(retessellateCursor, kRetessellateBatch);
+    SceneEvent event;
+    event.type = SceneEvent::Remesh;
+    event.first = evictedDrops + static_cast<uint32_t>(retessellateCursor);
+    event.count = static_cast<uint32_t>(kRetessellateBatch);
+    RecordResolvePoint(event);
+    retessellateCursor += kRetessellateBatch;
+}
+
+void SuminagashiApp::BakeSettledDrops()
+{
+    if (bakeMaxLiveDrops <= 0 && bakeMaxAge <= 0.0f)
+    {
+        return;
+    }
+    const double now = GetTime();
+    const size_t total = scene.Drops().Size();
+    dropBirth.resize(total, now);
+
+    size_t count = 0;
+    if (bakeMaxLiveDrops > 0 && total > static_cast<size_t>(bakeMaxLiveDrops))
+    {
+        count = total - static_cast<size_t>(bakeMaxLiveDrops * kBakeLowWater);
+    }
+    if (bakeMaxAge > 0.0f)
+    {
+        // Drops are in creation order, so the expired ones form a prefix.
+        size_t expired = count;
+        while (expired < total && now - dropBirth[expired] > bakeMaxAge)
+        {
+            ++expired;
+        }
+        if (expired > count && (expired - count >= kMinBakeBatch || now - lastBakeTime >= kMinBakeInterval))
+        {
+            count = expired;
+        }
+    }
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Only a prefix can be baked: the layer is drawn under every live drop,
+    // so nothing older than a live drop may end up in it.
+    bakeList.clear();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (!scene.Drops()[i].isRetired())
+        {
+            bakeList.push_back(i);
+        }
+    }
+    scene.ResolveDrops(bakeList);
+    SceneEvent event;
+    event.type = SceneEvent::ResolveRange;
+    event.first = evictedDrops;
+    event.count = static_cast<uint32_t>(count);
+    RecordResolvePoint(event);
+    if (!bakedLayer.Bake(scene, count, GetScreenWidth(), GetScreenHeight()))
+    {
+        return;
+    }
+    scene.EvictPrefix(count);
+    evictedDrops += static_cast<uint32_t>(count);
+    renderer.ErasePrefix(count);
+    dropBirth.erase(dropBirth.begin(), dropBirth.begin() + static_cast<std::ptrdiff_t>(count));
+    if (retessellateCursor != SIZE_MAX)
+    {
+        retessellateCursor -= std::min(retessellateCursor, count);
+    }
+    lastBakeTime = now;
+}
+
+void SuminagashiApp::DrawVertexScene(Rectangle viewport, const DropAnimation& animation)
+{
+    bakedLayer.Draw();
+    frameStats.Lap(FramePhase::Submit);
+    scene.ResolveVisible(viewport, kDeformMargin, visibleDrops);
+    SceneEvent event;
+    event.type = SceneEvent::Resolve;
+    event.width = static_cast<int>(viewport.width);
+    event.height = static_cast<int>(viewport.height);
+    event.margin = kDeformMargin;
+    RecordResolvePoint(event);
+    frameStats.Lap(FramePhase::Marble);
+    DropStore& drops = scene.Drops();
+    if (!renderer.AnimatesOnGpu())
+    {
+        // Immediate-mode fallback: deform on the CPU. This only reads and
+        // writes each drop's own vertices, so it runs on the job system;
+        // rlgl calls stay on the main thread.
+        JobSystem::Instance().ParallelFor(visibleDrops.size(), kDeformGrain, [&drops, &animation, this](size_t begin, size_t end)
+                                          {
+            for (size_t k = begin; k < end; ++k)
+            {
+                drops[visibleDrops[k]].deform(animation);
+            } });
+    }
+    frameStats.Lap(FramePhase::Deform);
+    renderer.Draw(drops, visibleDrops, animation);
+    frameStats.Lap(FramePhase::Submit);
+}
+
 void SuminagashiApp::UpdateDrops()
 {
-    const float time = static_cast<float>(GetTime());
-    for (auto& drop : drops)
+    const int width = GetScreenWidth();
+    const int height = GetScreenHeight();
+    const Rectangle viewport{0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)};
+    // Warp the baked background by this frame's new ops. It keeps following
+    // the log under the pixel engine too, so switching back is seamless.
+    bakedLayer.Reproject(scene, width, height);
+
+    if (renderEngine == RenderEngine::Pixel && pixelEngine.IsAvailable())
     {
-        drop.applyEdgeNoise(0.16f, 6.0f, time);
-        drop.animateShape(time, 0.12f, 2.0f, 3);
-        drop.Draw_drops();
+        if (!pixelEngine.IsActive() && pixelEngine.BeginCapture(scene, width, height))
+        {
+            // Start from what the vertex engine shows, minus the animation.
+            DrawVertexScene(viewport, DropAnimation{});
+            pixelEngine.EndCapture(scene);
+        }
+        pixelEngine.Sync(scene, width, height);
+        frameStats.Lap(FramePhase::Marble);
+        pixelEngine.Draw();
+        // Drops are only resolved when needed again; keep the log bounded.
+        scene.TrimLog();
+        SceneEvent event;
+        event.type = SceneEvent::Trim;
+        RecordResolvePoint(event);
+        frameStats.Lap(FramePhase::Submit);
+        return;
     }
+    if (pixelEngine.IsActive())
+    {
+        pixelEngine.Reset(scene);
+    }
+
+    // Move settled drops into the background before drawing it.
+    BakeSettledDrops();
+    ContinueRetessellation();
+    frameStats.Lap(FramePhase::Marble);
+    DropAnimation animation;
+    animation.time = static_cast<float>(GetTime());
+    animation.noiseAmplitude = kEdgeNoiseAmplitude;
+    animation.noiseFrequency = 6.0f;
+    animation.rippleAmplitude = kRippleAmplitude;
+    animation.rippleSpeed = 2.0f;
+    animation.harmonics = 3;
+    DrawVertexScene(viewport, animation);
 }
 
 void SuminagashiApp::DrawFrame()
@@ -198,18 +559,22 @@ void SuminagashiApp::DrawFrame()
         return;
     }
 
+    frameStats.BeginFrame();
     if (IsWindowResized())
     {
         metrics.renderWidth = GetRenderWidth();
         metrics.renderHeight = GetRenderHeight();
         LogCanvasMetrics("resize");
+        RecordViewport();
     }
 
     HandleInput();
-    UpdateAdaptiveVertexCount(GetFPS());
+    UpdateFrameBudget(GetFPS());
+    frameStats.Lap(FramePhase::Input);
 
     BeginDrawing();
     ClearBackground(RAYWHITE);
+    frameStats.Lap(FramePhase::Submit);
     UpdateDrops();
     DrawText(TextFormat("FPS: %.1f", averageFps), 20, 20, 24, DARKGRAY);
     const char* modeText = "Mode: Drops";
@@ -225,12 +590,145 @@ void SuminagashiApp::DrawFrame()
         modeColor = BLUE;
     }
     DrawText(modeText, 20, 50, 20, modeColor);
+    if (frameStatsOverlay)
+    {
+        DrawFrameStatsOverlay();
+    }
+    frameStats.Lap(FramePhase::Submit);
     EndDrawing();
+    frameStats.Lap(FramePhase::Present);
+}
+
+void SuminagashiApp::DrawFrameStatsOverlay()
+{
+    const float* summary = frameStats.Summary();
+    const int left = 20;
+    int y = 80;
+    DrawRectangle(left - 6, y - 6, 300, kStatsGraphHeight + 42 + 18 * static_cast<int>(FrameStats::kRowCount), Fade(RAYWHITE, 0.85f));
+    DrawText("ms        p50    p95    p99", left, y, 16, DARKGRAY);
+    y += 18;
+    for (size_t row = 0; row < FrameStats::kRowCount; ++row)
+    {
+        const float* values = summary + row * FrameStats::kColumnCount;
+        DrawText(TextFormat("%-8s %6.2f %6.2f %6.2f", FrameStats::PhaseName(row), values[0], values[1], values[2]), left, y, 16,
+                 row < FrameStats::kPhaseCount ? kStatsPhaseColors[row] : BLACK);
+        y += 18;
+    }
+
+    DrawText(TextFormat("detail %.2f (level %d), %d vertices/drop", frameBudget.Detail(), frameBudget.Level(), currentN), left, y, 16, DARKGRAY);
+    y += 18;
+
+    // Stacked per-phase bars for recent frames, newest on the right, with
+    // the 60 Hz budget as a guide line.
+    y += 4;
+    const float scale = static_cast<float>(kStatsGraphHeight) / kStatsGraphMs;
+    const int bars = static_cast<int>(std::min<size_t>(frameStats.SampleCount(), kStatsGraphFrames));
+    for (int age = 0; age < bars; ++age)
+    {
+        const int x = left + 2 * (static_cast<int>(kStatsGraphFrames) - 1 - age);
+        float base = 0.0f;
+        for (size_t phase = 0; phase < FrameStats::kPhaseCount; ++phase)
+        {
+            const float ms = std::min(frameStats.Sample(phase, static_cast<size_t>(age)), kStatsGraphMs - base);
+            const int top = y + kStatsGraphHeight - static_cast<int>((base + ms) * scale);
+            DrawRectangle(x, top, 2, static_cast<int>(ms * scale + 0.5f), kStatsPhaseColors[phase]);
+            base += ms;
+        }
+    }
+    const int budgetY = y + kStatsGraphHeight - static_cast<int>(1000.0f / 60.0f * scale);
+    DrawLine(left, budgetY, left + 2 * static_cast<int>(kStatsGraphFrames), budgetY, RED);
 }
 
 void SuminagashiApp::ClearCanvas()
 {
-    drops.clear();
+    SceneEvent event;
+    event.type = SceneEvent::Clear;
+    event.time = SessionTime();
+    eventLog.Append(event);
+    scene.Clear();
+    renderer.Reset();
+    bakedLayer.Reset();
+    pixelEngine.Reset(scene);
+    dropBirth.clear();
+    evictedDrops = 0;
+    strokeOpen = false;
+}
+
+void SuminagashiApp::BeginAction()
+{
+    strokeOpen = false;
+    SceneEvent event;
+    event.type = SceneEvent::Checkpoint;
+    event.time = SessionTime();
+    eventLog.Append(event);
+    // Baked drops cannot be taken back out of the layer, so there is
+    // nothing to keep copies for.
+    if (!bakedLayer.IsActive())
+    {
+        scene.Checkpoint();
+    }
+}
+
+bool SuminagashiApp::CanUndo() const
+{
+    return !bakedLayer.IsActive() && scene.CanUndo();
+}
+
+bool SuminagashiApp::CanRedo() const
+{
+    return !bakedLayer.IsActive() && scene.CanRedo();
+}
+
+bool SuminagashiApp::Undo()
+{
+    if (!CanUndo())
+    {
+        return false;
+    }
+    // The pixel engine's texture shows the present and pins the ops undo
+    // removes; it captures the restored drops on its next frame instead.
+    pixelEngine.Reset(scene);
+    if (!scene.Undo())
+    {
+        return false;
+    }
+    FinishHistoryStep(SceneEvent::Undo);
+    return true;
+}
+
+bool SuminagashiApp::Redo()
+{
+    if (!CanRedo())
+    {
+        return false;
+    }
+    pixelEngine.Reset(scene);
+    if (!scene.Redo())
+    {
+        return false;
+    }
+    FinishHistoryStep(SceneEvent::Redo);
+    return true;
+}
+
+void SuminagashiApp::FinishHistoryStep(SceneEvent::Type type)
+{
+    SceneEvent event;
+    event.type = type;
+    event.time = SessionTime();
+    eventLog.Append(event);
+    // Restored drops carry new revisions, so the renderer only rewrites
+    // those; slots of removed drops go now.
+    renderer.Truncate(scene.Drops().Size());
+    dropBirth.resize(scene.Drops().Size(), GetTime());
+    strokeOpen = false;
+    std::cout << "[history] " << (type == SceneEvent::Undo ? "undo" : "redo") << ", " << scene.HistoryLevels()
+              << " steps in " << scene.HistoryBytes() / 1024 << " KiB" << std::endl;
+}
+
+void SuminagashiApp::SetHistoryLimits(int levels, int megabytes)
+{
+    scene.SetHistoryLimits(static_cast<size_t>(std::max(levels, 0)), static_cast<size_t>(std::max(megabytes, 0)) << 20);
 }
 
 void SuminagashiApp::ToggleTineMode(int on)
@@ -245,14 +743,77 @@ void SuminagashiApp::SetInteractionMode(int mode)
 
 void SuminagashiApp::ApplyTineAt(float x, float strength, float sharpness)
 {
-    for (auto& drop : drops)
+    if (!AllFinite({x, strength, sharpness}))
     {
-        drop.applyVerticalTine(x, strength, sharpness, true);
+        return;
     }
+    SceneEvent event;
+    event.type = SceneEvent::Tine;
+    event.time = SessionTime();
+    event.x = x;
+    event.strength = strength;
+    event.sharpness = sharpness;
+    BeginAction();
+    eventLog.Append(event);
+    scene.AddTine(x, strength, sharpness);
 }
 
-void SuminagashiApp::SetTineParams(float, float)
+void SuminagashiApp::ApplyTineStroke(const Vector2* points, size_t count, float strength, float sharpness)
 {
+    if (!points || count < 2 || !AllFinite({strength, sharpness}) ||
+        !std::all_of(points, points + count, [](const Vector2& p) { return AllFinite({p.x, p.y}); }))
+    {
+        return;
+    }
+    // A call that starts where the previous stroke ended continues the same
+    // drag, and so the same undo step.
+    if (!strokeOpen || points[0].x != strokeEnd.x || points[0].y != strokeEnd.y)
+    {
+        BeginAction();
+    }
+    strokeOpen = true;
+    strokeEnd = points[count - 1];
+    SceneEvent event;
+    event.type = SceneEvent::TineSegment;
+    event.time = SessionTime();
+    event.strength = strength;
+    event.sharpness = sharpness;
+    for (size_t i = 1; i < count; ++i)
+    {
+        event.x = points[i - 1].x;
+        event.y = points[i - 1].y;
+        event.x1 = points[i].x;
+        event.y1 = points[i].y;
+        eventLog.Append(event);
+    }
+    scene.AddTineStroke(points, count, strength, sharpness);
+}
+
+void SuminagashiApp::ApplyRake(float x, float y, float angleDegrees, int tines, float spacing, float strength, float sharpness)
+{
+    if (!AllFinite({x, y, angleDegrees, spacing, strength, sharpness}))
+    {
+        return;
+    }
+    SceneEvent event;
+    event.type = SceneEvent::Rake;
+    event.time = SessionTime();
+    event.x = x;
+    event.y = y;
+    event.angle = angleDegrees;
+    event.tines = std::clamp(tines, 0, 65535);
+    event.spacing = spacing;
+    event.strength = strength;
+    event.sharpness = sharpness;
+    BeginAction();
+    eventLog.Append(event);
+    scene.AddRake(x, y, angleDegrees, tines, spacing, strength, sharpness);
+}
+
+void SuminagashiApp::SetTineParams(float strength, float sharpness)
+{
+    tineStrength = strength;
+    tineSharpness = sharpness;
 }
 
 void SuminagashiApp::SetNextDropRadius(int radius)
@@ -265,6 +826,17 @@ void SuminagashiApp::SetNextDropColor(int r, int g, int b, int a)
     nextDropColor = color(std::clamp(r, 0, 255), std::clamp(g, 0, 255), std::clamp(b, 0, 255), std::clamp(a, 0, 255));
 }
 
+int SuminagashiApp::PickDropAt(float x, float y)
+{
+    const int index = scene.PickDrop(x, y);
+    SceneEvent event;
+    event.type = SceneEvent::Pick;
+    event.x = x;
+    event.y = y;
+    RecordResolvePoint(event);
+    return index;
+}
+
 int SuminagashiApp::GetCurrentPaletteSize() const
 {
     return static_cast<int>(colorGenerator.getCurrentPalette().size());
@@ -295,7 +867,18 @@ void SuminagashiApp::SetPaletteIndex(int index)
 
 void SuminagashiApp::SetQualityMode(int mode)
 {
+    // An explicit choice starts from that mode's full detail; the budget
+    // controller steps down from there again if the scene is too heavy.
     qualityMode = ClampQualityMode(mode);
+    frameBudget.Reset();
+    RecordQuality();
+    ApplyDetailLevel(true);
+}
+
+void SuminagashiApp::SetFrameBudget(float milliseconds)
+{
+    frameBudget.SetBudget(milliseconds);
+    ApplyDetailLevel(true);
 }
 
 int SuminagashiApp::GetQualityMode() const
@@ -308,6 +891,28 @@ float SuminagashiApp::GetQualityScale() const
     return QualityScaleForMode(qualityMode);
 }
 
+void SuminagashiApp::SetRenderEngine(int engine)
+{
+    renderEngine = engine == 1 ? RenderEngine::Pixel : RenderEngine::Vertex;
+}
+
+int SuminagashiApp::GetRenderEngine() const
+{
+    return static_cast<int>(renderEngine);
+}
+
+void SuminagashiApp::SetCompactStorage(bool on)
+{
+    scene.Drops().SetCompact(on);
+    renderer.SetCompact(on);
+    std::cout << "[memory] compact storage " << (on ? "on" : "off") << ", " << GetGeometryBytes() / 1024 << " KiB geometry" << std::endl;
+}
+
+size_t SuminagashiApp::GetGeometryBytes() const
+{
+    return scene.Drops().PoolFloatsCapacity() * sizeof(float) + renderer.HeapBytes();
+}
+
 void SuminagashiApp::SyncCanvasViewport(int cssWidth, int cssHeight, float devicePixelRatio, float qualityScale)
 {
     metrics.cssWidth = std::max(1, cssWidth);
@@ -329,6 +934,7 @@ void SuminagashiApp::SyncCanvasViewport(int cssWidth, int cssHeight, float devic
     if (IsWindowReady())
     {
         SetWindowSize(metrics.renderWidth, metrics.renderHeight);
+        RecordViewport();
     }
 
     LogCanvasMetrics("sync");
@@ -346,6 +952,66 @@ void SuminagashiApp::RequestNativeScreenshot()
     std::cout << "[screenshot] saved " << filename << std::endl;
 }
 
+void SuminagashiApp::SetBakeLimits(int maxLiveDrops, float maxAgeSeconds)
+{
+    bakeMaxLiveDrops = std::max(maxLiveDrops, 0);
+    bakeMaxAge = std::max(maxAgeSeconds, 0.0f);
+}
+
+bool SuminagashiApp::SaveEventLog(const std::string& path) const
+{
+    if (!eventLog.Save(path))
+    {
+        std::cout << "[events] failed to save " << path << std::endl;
+        return false;
+    }
+    std::cout << "[events] saved " << eventLog.EventCount() << " events to " << path << std::endl;
+    return true;
+}
+
+bool SuminagashiApp::ReplayEventLog(const std::string& path)
+{
+    EventLog loaded;
+    if (!loaded.Load(path))
+    {
+        std::cout << "[events] cannot read " << path << std::endl;
+        return false;
+    }
+    const std::vector<SceneEvent> events = loaded.Events();
+    renderer.Reset();
+    bakedLayer.Reset();
+    pixelEngine.Reset(scene);
+    strokeOpen = false;
+    evictedDrops = 0;
+    const ReplayResult replay = ReplayEvents(events, scene);
+    dropBirth.assign(scene.Drops().Size(), GetTime());
+    // Keep recording on top of the replayed session, starting with the
+    // replay's final resolve, so the extended log replays the same way.
+    eventLog = loaded;
+    rng.seed(eventLog.Seed());
+    sessionStart = GetTime() - (events.empty() ? 0.0 : events.back().time);
+    SceneEvent resolved;
+    resolved.type = SceneEvent::ResolveRange;
+    resolved.count = static_cast<uint32_t>(scene.Drops().Size());
+    RecordResolvePoint(resolved);
+    resolved.type = SceneEvent::Trim;
+    RecordResolvePoint(resolved);
+    recordedDetailLevel = replay.level;
+    for (auto it = events.rbegin(); it != events.rend(); ++it)
+    {
+        if (it->type == SceneEvent::Quality)
+        {
+            qualityMode = ClampQualityMode(it->quality);
+            break;
+        }
+    }
+    // The replay ran at the recorded quality and detail; re-apply the
+    // current detail, resampling the drops if it differs.
+    ApplyDetailLevel(frameBudget.Level() != replay.level);
+    std::cout << "[events] replayed " << events.size() << " events from " << path << std::endl;
+    return true;
+}
+
 void SuminagashiApp::LogCanvasMetrics(const char* reason) const
 {
     std::cout << "[layout] " << reason
@@ -1,10 +1,19 @@
 #pragma once
 
+#include "baked_layer.h"
 #include "colors.h"
+#include "drop_renderer.h"
 #include "drops.h"
+#include "event_log.h"
+#include "frame_budget.h"
+#include "frame_stats.h"
+#include "pixel_engine.h"
 #include "raylib.h"
+#include "scene.h"
 
 #include <array>
+#include <cstdint>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -15,6 +24,22 @@ enum class QualityMode
     High = 2
 };
 
+enum class RenderEngine
+{
+    Vertex = 0,
+    Pixel = 1
+};
+
+// One drop of a batched insertion (see SuminagashiApp::InsertDrops); the
+// layout JavaScript writes into the heap, 16 bytes per drop.
+struct DropRecord
+{
+    float x = 0.0f, y = 0.0f;
+    float radius = 0.0f;
+    uint32_t rgba = 0; // 0xRRGGBBAA
+};
+static_assert(sizeof(DropRecord) == 16, "DropRecord is read straight from the wasm heap");
+
 struct CanvasMetrics
 {
     int cssWidth = 1200;
@@ -38,9 +63,36 @@ public:
     void ToggleTineMode(int on);
     void SetInteractionMode(int mode);
     void ApplyTineAt(float x, float strength, float sharpness);
+    // Drag a tine along the polyline `points` (canvas pixels): ink near the
+    // path is pushed about `strength` px along it. Each segment is recorded
+    // in the event log.
+    void ApplyTineStroke(const Vector2* points, size_t count, float strength, float sharpness);
+    // Pull a comb of `tines` tines `spacing` px apart, centered on (x, y),
+    // by `strength` px along `angleDegrees` (90 is down); see
+    // MarblingScene::AddRake. Recorded in the event log.
+    void ApplyRake(float x, float y, float angleDegrees, int tines, float spacing, float strength, float sharpness);
+    // Strength and sharpness of native tine-mode drags.
     void SetTineParams(float strength, float sharpness);
     void SetNextDropRadius(int radius);
     void SetNextDropColor(int r, int g, int b, int a);
+    int PickDropAt(float x, float y);
+    // Add drops in order, as if clicked one after another without palette
+    // target colors, and record them in the event log. Records with
+    // non-finite fields are skipped; radii are clamped like SetNextDropRadius.
+    // Returns the number of drops added.
+    size_t InsertDrops(const DropRecord* records, size_t count);
+
+    // Undo and redo whole actions: a click, a tine, a rake, an InsertDrops
+    // batch, or a drag of tine strokes (calls that each start where the
+    // previous one ended). Unavailable once drops have been baked. Both are
+    // recorded in the event log.
+    bool Undo();
+    bool Redo();
+    bool CanUndo() const;
+    bool CanRedo() const;
+    // At most `levels` undo steps in about `megabytes` of memory; the oldest
+    // steps are dropped first. 0 levels turns undo off.
+    void SetHistoryLimits(int levels, int megabytes);
 
     int GetCurrentPaletteSize() const;
     int GetCurrentPaletteColor(int index) const;
@@ -49,28 +101,110 @@ public:
 
     void SetQualityMode(int mode);
     int GetQualityMode() const;
+    // Frame-time target for the detail controller, in milliseconds (0 turns
+    // it off). Existing drops are resampled when the detail level changes.
+    void SetFrameBudget(float milliseconds);
+    int GetDetailLevel() const { return frameBudget.Level(); }
     float GetQualityScale() const;
 
+    void SetRenderEngine(int engine);
+    int GetRenderEngine() const;
+
+    // Compact geometry storage (see DropStore::kCompactStreamsPerDrop and
+    // DropRenderer): about a quarter of the heap per vertex. Existing drops
+    // are converted in place.
+    void SetCompactStorage(bool on);
+    bool GetCompactStorage() const { return scene.Drops().IsCompact(); }
+    // Heap bytes held for drop geometry: the vertex pool and the renderer's
+    // CPU-side buffers.
+    size_t GetGeometryBytes() const;
+
     void SyncCanvasViewport(int cssWidth, int cssHeight, float devicePixelRatio, float qualityScale);
     void RequestNativeScreenshot();
+    // Bake drops into the background layer once more than `maxLiveDrops`
+    // are live or once they are older than `maxAgeSeconds`; 0 disables
+    // either limit.
+    void SetBakeLimits(int maxLiveDrops, float maxAgeSeconds);
+
+    // Every scene mutation of the session is recorded; see EventLog.
+    const EventLog& GetEventLog() const { return eventLog; }
+    bool SaveEventLog(const std::string& path) const;
+    // Rebuild the scene from a saved log and keep recording after it.
+    bool ReplayEventLog(const std::string& path);
+
+    // Per-phase timings of recent frames; see FrameStats::Summary().
+    FrameStats& GetFrameStats() { return frameStats; }
+    void SetFrameStatsOverlay(bool on) { frameStatsOverlay = on; }
 
 private:
     void HandleInput();
     void UpdateDrops();
-    void UpdateAdaptiveVertexCount(float fps);
+    void BakeSettledDrops();
+    void DrawVertexScene(Rectangle viewport, const DropAnimation& animation);
+    void DrawFrameStatsOverlay();
+    // Feed the frame budget controller and apply its detail changes.
+    void UpdateFrameBudget(float fps);
+    // Remesh limits and new-drop vertex count for the quality mode at the
+    // controller's detail; optionally start resampling existing drops.
+    void ApplyDetailLevel(bool retessellate);
+    void ContinueRetessellation();
     void EnsureDefaultNextDropColor();
     void LogCanvasMetrics(const char* reason) const;
+    // Open an undo step for an action about to be recorded.
+    void BeginAction();
+    // Renderers and per-drop state follow the scene after an undo or redo.
+    void FinishHistoryStep(SceneEvent::Type type);
+    float SessionTime() const;
+    void RecordQuality();
+    void RecordViewport();
+    void RecordDetail();
+    // Log a point where the scene resolved drops (see SceneEvent::Resolve),
+    // unless it repeats the previous record.
+    void RecordResolvePoint(SceneEvent event);
     static QualityMode ClampQualityMode(int mode);
     static float QualityScaleForMode(QualityMode mode);
+    static RemeshParams RemeshParamsForMode(QualityMode mode);
 
     ColorPalette colorGenerator;
-    std::vector<Drop> drops;
+    std::mt19937 rng;
+    EventLog eventLog;
+    double sessionStart = 0.0;
+    MarblingScene scene;
+    DropRenderer renderer;
+    BakedLayer bakedLayer;
+    PixelEngine pixelEngine;
+    RenderEngine renderEngine = RenderEngine::Vertex;
+    // Creation time of each scene drop, same indices.
+    std::vector<double> dropBirth;
+    std::vector<uint32_t> bakeList;
+    // Drops evicted into the baked layer since the last clear. Resolve
+    // points index drops as if they were still in the scene.
+    uint32_t evictedDrops = 0;
+    int bakeMaxLiveDrops = 0;
+    float bakeMaxAge = 0.0f;
+    double lastBakeTime = 0.0;
+    std::vector<uint32_t> visibleDrops;
     CanvasMetrics metrics;
+    FrameStats frameStats;
+    bool frameStatsOverlay = false;
     std::array<float, 30> fpsHistory{};
     int fpsIndex = 0;
     float averageFps = 60.0f;
-    int currentN = 200;
+    FrameBudgetController frameBudget;
+    // Detail level the event log is at; replay resets it on Quality events.
+    int recordedDetailLevel = 0;
+    // Next drop index of the resampling sweep, SIZE_MAX when none runs.
+    size_t retessellateCursor = SIZE_MAX;
+    int currentN = 400;
     int interactionMode = 0;
+    float tineStrength = 80.0f;
+    float tineSharpness = 32.0f;
+    // Last point of the native tine drag in progress.
+    bool tineDragging = false;
+    Vector2 tineLast{};
+    // End of the last tine stroke while it can still be continued.
+    bool strokeOpen = false;
+    Vector2 strokeEnd{};
     int nextDropRadius = 80;
     color nextDropColor;
     QualityMode qualityMode = QualityMode::Balanced;
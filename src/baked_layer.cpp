@@ -0,0 +1,265 @@
+#include "baked_layer.h"
+
+#include "rlgl.h"
+#include "triangulate.h"
+#include "warp_shader.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace
+{
+// Ops applied per warp pass; longer bursts take several passes.
+constexpr int kOpsPerPass = 16;
+
+// Runs on a full-target quad drawn with raylib's default vertex shader.
+// ops holds two vec4s per op as packed by PackWarpOp, newest first, because
+// a pixel is pulled back through the ops in reverse order. Pixels that land
+// inside a new drop have no preimage: the drop pushed all ink out of them.
+constexpr const char* kWarpInputs = R"(
+IN vec2 fragTexCoord;
+IN vec4 fragColor;
+uniform sampler2D texture0;
+uniform vec2 size;
+uniform vec4 background;
+uniform int opCount;
+uniform vec4 ops[32];
+)";
+
+constexpr const char* kWarpMain = R"(
+void main()
+{
+    // Render textures are stored bottom-up; p is in canvas pixels.
+    vec2 p = vec2(fragTexCoord.x, 1.0 - fragTexCoord.y) * size;
+    for (int i = 0; i < 16; ++i)
+    {
+        if (i >= opCount)
+            break;
+        if (!unwarp(p, ops[2 * i], ops[2 * i + 1]))
+        {
+            finalColor = background;
+            return;
+        }
+    }
+    vec2 uv = p / size;
+    if (uv.x < 0.0 || uv.y < 0.0 || uv.x > 1.0 || uv.y > 1.0)
+    {
+        finalColor = background;
+        return;
+    }
+    finalColor = TEXTURE(texture0, vec2(uv.x, 1.0 - uv.y));
+}
+)";
+
+// Draw `source` upright at the origin, replacing what is underneath. Alpha
+// below 1 (translucent drops baked over the background) must not let the
+// previous contents or the cleared screen show through a second time.
+void DrawOpaque(const RenderTexture2D& source)
+{
+    const Rectangle flipped{0.0f, 0.0f, static_cast<float>(source.texture.width), -static_cast<float>(source.texture.height)};
+    rlDrawRenderBatchActive();
+    rlDisableColorBlend();
+    DrawTextureRec(source.texture, flipped, {0.0f, 0.0f}, WHITE);
+    rlDrawRenderBatchActive();
+    rlEnableColorBlend();
+}
+} // namespace
+
+bool BakedLayer::EnsureShader()
+{
+    if (warp.id != 0 || shaderFailed)
+    {
+        return warp.id != 0;
+    }
+    const std::string fragment = std::string(kWarpShaderHeader) + kWarpInputs + kWarpShaderInverse + kWarpMain;
+    warp = LoadShaderFromMemory(nullptr, fragment.c_str());
+    if (!IsShaderReady(warp) || warp.id == rlGetShaderIdDefault())
+    {
+        std::cout << "[bake] warp shader unavailable, drops stay live" << std::endl;
+        warp = Shader{};
+        shaderFailed = true;
+        return false;
+    }
+    sizeLoc = GetShaderLocation(warp, "size");
+    backgroundLoc = GetShaderLocation(warp, "background");
+    opCountLoc = GetShaderLocation(warp, "opCount");
+    opsLoc = GetShaderLocation(warp, "ops");
+    return true;
+}
+
+bool BakedLayer::EnsureTargets(int width, int height)
+{
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if (target.id != 0 && target.texture.width == width && target.texture.height == height)
+    {
+        return true;
+    }
+    RenderTexture2D next = LoadRenderTexture(width, height);
+    RenderTexture2D nextScratch = LoadRenderTexture(width, height);
+    if (next.id == 0 || nextScratch.id == 0)
+    {
+        std::cout << "[bake] render target " << width << "x" << height << " unavailable" << std::endl;
+        UnloadRenderTexture(next);
+        UnloadRenderTexture(nextScratch);
+        return false;
+    }
+    // Keep what was baked at its pixel position; a grown area starts empty.
+    BeginTextureMode(next);
+    ClearBackground(kWarpBackground);
+    if (target.id != 0)
+    {
+        DrawOpaque(target);
+    }
+    EndTextureMode();
+    UnloadTargets();
+    target = next;
+    scratch = nextScratch;
+    return true;
+}
+
+bool BakedLayer::Bake(MarblingScene& scene, size_t count, int width, int height)
+{
+    if (!EnsureShader())
+    {
+        return false;
+    }
+    const bool following = IsActive();
+    if (following)
+    {
+        // Bring the layer up to date before painting over it.
+        Reproject(scene, width, height);
+    }
+    else if (!EnsureTargets(width, height))
+    {
+        return false;
+    }
+
+    const DropStore& drops = scene.Drops();
+    count = std::min(count, drops.Size());
+    BeginTextureMode(target);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Drop& drop = drops[i];
+        const int n = drop.getVertexCount();
+        if (drop.isRetired() || n < 3)
+        {
+            continue;
+        }
+        const float* xs = drop.getBaseX();
+        const float* ys = drop.getBaseY();
+        const Vector2 center = drop.getCenter();
+        const color clr = drop.getColor();
+        rlBegin(RL_TRIANGLES);
+        rlColor4ub(static_cast<unsigned char>(clr.r), static_cast<unsigned char>(clr.g), static_cast<unsigned char>(clr.b), static_cast<unsigned char>(clr.a));
+        if (IsStarShapedFrom(xs, ys, n, center.x, center.y))
+        {
+            for (int v = 0; v < n; ++v)
+            {
+                const int next = v + 1 == n ? 0 : v + 1;
+                rlVertex2f(center.x, center.y);
+                rlVertex2f(xs[next], ys[next]);
+                rlVertex2f(xs[v], ys[v]);
+            }
+        }
+        else
+        {
+            TriangulatePolygon(xs, ys, n, triangles);
+            for (const uint32_t v : triangles)
+            {
+                rlVertex2f(xs[v], ys[v]);
+            }
+        }
+        rlEnd();
+    }
+    EndTextureMode();
+
+    if (!following)
+    {
+        cursor = scene.LogHead();
+        scene.PinLog(this, cursor);
+    }
+    return true;
+}
+
+void BakedLayer::Reproject(MarblingScene& scene, int width, int height)
+{
+    passes = 0;
+    if (!IsActive())
+    {
+        return;
+    }
+    EnsureTargets(width, height);
+    size_t count = 0;
+    const MarbleOp* ops = scene.OpsSince(cursor, count);
+    for (size_t first = 0; first < count; first += kOpsPerPass)
+    {
+        RunPass(ops + first, std::min(count - first, static_cast<size_t>(kOpsPerPass)));
+    }
+    cursor = scene.LogHead();
+    scene.PinLog(this, cursor);
+}
+
+void BakedLayer::RunPass(const MarbleOp* ops, size_t count)
+{
+    opData.resize(count * kWarpFloatsPerOp);
+    for (size_t k = 0; k < count; ++k)
+    {
+        PackWarpOp(ops[count - 1 - k], opData.data() + k * kWarpFloatsPerOp);
+    }
+
+    const float size[2] = {static_cast<float>(target.texture.width), static_cast<float>(target.texture.height)};
+    const float background[4] = {kWarpBackground.r / 255.0f, kWarpBackground.g / 255.0f, kWarpBackground.b / 255.0f, kWarpBackground.a / 255.0f};
+    const int opCount = static_cast<int>(count);
+    BeginTextureMode(scratch);
+    BeginShaderMode(warp);
+    SetShaderValue(warp, sizeLoc, size, SHADER_UNIFORM_VEC2);
+    SetShaderValue(warp, backgroundLoc, background, SHADER_UNIFORM_VEC4);
+    SetShaderValue(warp, opCountLoc, &opCount, SHADER_UNIFORM_INT);
+    SetShaderValueV(warp, opsLoc, opData.data(), SHADER_UNIFORM_VEC4, opCount * kWarpFloatsPerOp / 4);
+    DrawOpaque(target);
+    EndShaderMode();
+    EndTextureMode();
+    std::swap(target, scratch);
+    ++passes;
+}
+
+void BakedLayer::Draw() const
+{
+    if (!IsActive())
+    {
+        return;
+    }
+    DrawOpaque(target);
+}
+
+void BakedLayer::Reset()
+{
+    UnloadTargets();
+    cursor = 0;
+}
+
+void BakedLayer::Unload()
+{
+    UnloadTargets();
+    if (warp.id != 0)
+    {
+        UnloadShader(warp);
+        warp = Shader{};
+    }
+}
+
+void BakedLayer::UnloadTargets()
+{
+    if (target.id != 0)
+    {
+        UnloadRenderTexture(target);
+    }
+    if (scratch.id != 0)
+    {
+        UnloadRenderTexture(scratch);
+    }
+    target = RenderTexture2D{};
+    scratch = RenderTexture2D{};
+}
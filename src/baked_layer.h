@@ -0,0 +1,76 @@
+#pragma once
+
+#include "raylib.h"
+#include "scene.h"
+
+#include <cstdint>
+#include <vector>
+
+// Settled drops rasterized into a persistent background texture. Baked
+// drops are evicted from the scene, so they cost neither vertices nor
+// per-frame work; in exchange they stop animating. Marbling still reaches
+// them: every op recorded after a bake warps the layer with a fragment
+// shader that pulls each pixel back through the op's inverse map.
+//
+// The inverse of a drop insertion is exact (up to the displacement clamp
+// and the sub-pixel jitter of the vertex kernel). A tine is inverted as a
+// pure vertical shear with the falloff band of Drop::applyVerticalTine; the
+// per-drop band cap, the cumulative damping and the smoothing pass act on
+// individual outlines and have no pixel equivalent, so tined baked areas
+// track live drops only approximately. A tine segment keeps the distance to
+// its line, so its inverse only solves for the position along the stroke,
+// with a few Newton steps.
+//
+// The texture covers the render area; content pushed out of it is lost and
+// ink pulled in from outside comes back as background.
+//
+// A rake is a shear along its pull, so its inverse is exact: the position
+// across the comb is unchanged and names the tines to undo.
+class BakedLayer
+{
+public:
+    BakedLayer() = default;
+    ~BakedLayer() = default;
+    BakedLayer(const BakedLayer&) = delete;
+    BakedLayer& operator=(const BakedLayer&) = delete;
+
+    bool IsActive() const { return target.id != 0; }
+    // Paint the first `count` drops of the scene (resolved and in paint
+    // order) into the layer at their committed shape; the caller then evicts
+    // them. Starts following the scene's op log on the first bake. Returns
+    // false, painting nothing, if render targets or the warp shader are not
+    // available, in which case the drops must stay live.
+    bool Bake(MarblingScene& scene, size_t count, int width, int height);
+    // Warp the layer by every op recorded since the last call, resizing it
+    // first if the render area changed.
+    void Reproject(MarblingScene& scene, int width, int height);
+    // Draw the layer as the canvas background, replacing whatever is there.
+    // No-op while nothing is baked.
+    void Draw() const;
+    // Forget the baked content, e.g. after MarblingScene::Clear() (which
+    // also releases the layer's pin on the log).
+    void Reset();
+    void Unload();
+
+    size_t LastReprojectPasses() const { return passes; }
+
+private:
+    bool EnsureTargets(int width, int height);
+    bool EnsureShader();
+    void RunPass(const MarbleOp* ops, size_t count);
+    void UnloadTargets();
+
+    RenderTexture2D target{};
+    RenderTexture2D scratch{};
+    Shader warp{};
+    bool shaderFailed = false;
+    int sizeLoc = -1;
+    int backgroundLoc = -1;
+    int opCountLoc = -1;
+    int opsLoc = -1;
+    uint32_t cursor = 0;
+    std::vector<uint32_t> triangles;
+    std::vector<float> opData;
+    size_t passes = 0;
+};
+
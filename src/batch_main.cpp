@@ -0,0 +1,189 @@
+// Headless batch renderer: replays scene scripts (see scene_script.h) and
+// recorded sessions (*.sumilog, see event_log.h) and writes PNGs without
+// opening a window or touching GL, so it runs on display-less servers.
+// Inputs are rendered in parallel on the job system.
+//
+//   suminasashi_batch [-o <dir>] [-s <scale>] <input or directory>...
+//
+// Directories contribute every *.scene and *.sumilog file in them. Output
+// goes to the script's `output` path, else <dir>/<name>.png with -o, else
+// next to the input. -s renders recorded sessions at a multiple of their
+// window size.
+
+#include "colors.h"
+#include "cpu_raster.h"
+#include "event_log.h"
+#include "job_system.h"
+#include "raylib.h"
+#include "scene_script.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr const char* kScriptExtension = ".scene";
+constexpr const char* kLogExtension = ".sumilog";
+// Canvas for sessions that never recorded a viewport (the app's default).
+constexpr int kDefaultLogWidth = 1200;
+constexpr int kDefaultLogHeight = 800;
+
+struct BatchJob
+{
+    fs::path script;
+    bool ok = false;
+    std::string message;
+};
+
+void PrintUsage()
+{
+    std::cout << "usage: suminasashi_batch [-o <dir>] [-s <scale>] <input or directory>..." << std::endl;
+}
+
+fs::path OutputPath(const BatchJob& job, const std::string& scriptOutput, const fs::path& outputDir)
+{
+    if (!scriptOutput.empty())
+    {
+        const fs::path output(scriptOutput);
+        return output.is_absolute() ? output : job.script.parent_path() / output;
+    }
+    fs::path name = job.script.filename();
+    name.replace_extension(".png");
+    return outputDir.empty() ? job.script.parent_path() / name : outputDir / name;
+}
+
+void RenderJob(BatchJob& job, const fs::path& outputDir, float scale)
+{
+    MarblingScene scene;
+    SceneScript script;
+    if (job.script.extension() == kLogExtension)
+    {
+        EventLog log;
+        if (!log.Load(job.script.string()))
+        {
+            job.message = "cannot read " + job.script.string();
+            return;
+        }
+        const ReplayResult replay = ReplayEvents(log.Events(), scene, scale);
+        script.width = replay.width > 0 ? replay.width : static_cast<int>(kDefaultLogWidth * scale);
+        script.height = replay.height > 0 ? replay.height : static_cast<int>(kDefaultLogHeight * scale);
+    }
+    else
+    {
+        if (!LoadSceneScript(job.script.string(), script, job.message))
+        {
+            return;
+        }
+        BuildScene(script, scene);
+    }
+    CpuCanvas canvas(script.width, script.height);
+    RenderScene(scene, script.background, canvas);
+
+    const fs::path output = OutputPath(job, script.output, outputDir);
+    if (!ExportImage(canvas.AsImage(), output.string().c_str()))
+    {
+        job.message = "failed to write " + output.string();
+        return;
+    }
+    job.ok = true;
+    job.message = output.string() + " (" + std::to_string(scene.Drops().Size()) + " drops)";
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    fs::path outputDir;
+    float scale = 1.0f;
+    std::vector<BatchJob> jobs;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help")
+        {
+            PrintUsage();
+            return 0;
+        }
+        if (arg == "-o")
+        {
+            if (++i >= argc)
+            {
+                PrintUsage();
+                return 2;
+            }
+            outputDir = argv[i];
+            continue;
+        }
+        if (arg == "-s")
+        {
+            if (++i >= argc || (scale = std::strtof(argv[i], nullptr)) <= 0.0f)
+            {
+                PrintUsage();
+                return 2;
+            }
+            continue;
+        }
+        std::error_code ec;
+        if (fs::is_directory(arg, ec))
+        {
+            std::vector<fs::path> found;
+            for (const fs::directory_entry& entry : fs::directory_iterator(arg, ec))
+            {
+                if (entry.is_regular_file() &&
+                    (entry.path().extension() == kScriptExtension || entry.path().extension() == kLogExtension))
+                {
+                    found.push_back(entry.path());
+                }
+            }
+            std::sort(found.begin(), found.end());
+            for (const fs::path& path : found)
+            {
+                jobs.emplace_back().script = path;
+            }
+        }
+        else
+        {
+            jobs.emplace_back().script = arg;
+        }
+    }
+    if (jobs.empty())
+    {
+        PrintUsage();
+        return 2;
+    }
+    if (!outputDir.empty())
+    {
+        std::error_code ec;
+        fs::create_directories(outputDir, ec);
+    }
+
+    // Palettes are built lazily; do it once before the workers read them.
+    ColorPalette::getAllPalettes();
+    SetTraceLogLevel(LOG_WARNING);
+
+    const auto start = std::chrono::steady_clock::now();
+    JobSystem::Instance().ParallelFor(jobs.size(), 1, [&jobs, &outputDir, scale](size_t begin, size_t end)
+                                      {
+        for (size_t k = begin; k < end; ++k)
+        {
+            RenderJob(jobs[k], outputDir, scale);
+        } });
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t rendered = 0;
+    for (const BatchJob& job : jobs)
+    {
+        std::cout << (job.ok ? "[batch] " : "[batch] error: ") << job.message << std::endl;
+        rendered += job.ok ? 1 : 0;
+    }
+    std::cout << "[batch] rendered " << rendered << "/" << jobs.size() << " scenes in " << seconds << " s ("
+              << (seconds > 0.0 ? static_cast<double>(rendered) / seconds : 0.0) << " renders/s, "
+              << JobSystem::Instance().ThreadCount() << " threads)" << std::endl;
+    return rendered == jobs.size() ? 0 : 1;
+}
@@ -0,0 +1,299 @@
+// Microbenchmarks for the Drop geometry kernels. Runs headless (no window
+// or GL context), so kernel changes can be measured on CI machines.
+//
+//   suminasashi_bench [--min-time <seconds>] [--csv] [filter]
+//
+// Each kernel runs over a grid of vertex counts and drop counts; `filter`
+// keeps only benchmarks whose name contains it (e.g. "marble/600").
+// Throughput is reported in vertices per second (drops per second for
+// updateColor, which does not touch vertices).
+
+#include "drop_store.h"
+#include "drops.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr int kVertexCounts[] = {200, 400, 600, 1000, 2000};
+constexpr int kDropCounts[] = {1, 100, 1000, 10000};
+// Skip grid points whose pools would not fit comfortably in memory
+// (kStreamsPerDrop floats per vertex: 10k drops x 600 vertices is ~190 MB).
+constexpr size_t kMaxTotalVertices = 6000000;
+constexpr float kCanvasWidth = 1920.0f;
+constexpr float kCanvasHeight = 1080.0f;
+// MarblingScene's default far-field tolerance, in px.
+constexpr float kFarFieldTolerance = 0.1f;
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    double minTime = 0.25;
+    bool csv = false;
+    std::string filter;
+};
+
+// A store of `drops` drops with `vertices` vertices each, scattered over a
+// full-HD canvas with a fixed seed so runs are comparable.
+std::unique_ptr<DropStore> MakeScene(int vertices, int drops)
+{
+    auto store = std::make_unique<DropStore>();
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> xs(0.0f, kCanvasWidth);
+    std::uniform_real_distribution<float> ys(0.0f, kCanvasHeight);
+    std::uniform_real_distribution<float> radii(10.0f, 80.0f);
+    for (int i = 0; i < drops; ++i)
+    {
+        const float x = xs(rng);
+        const float y = ys(rng);
+        store->Emplace(x, y, color(200, 80, 40, 255), radii(rng), vertices);
+    }
+    return store;
+}
+
+struct Result
+{
+    std::string name;
+    long iterations = 0;
+    double secondsPerIteration = 0.0;
+    double itemsPerSecond = 0.0;
+};
+
+// Run `body` (one iteration processing `items` items) until at least
+// minTime has elapsed, after one untimed warm-up iteration.
+Result Measure(const std::string& name, double items, double minTime, const std::function<void()>& body)
+{
+    body();
+    long iterations = 0;
+    const Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    do
+    {
+        body();
+        ++iterations;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minTime);
+
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.secondsPerIteration = elapsed / static_cast<double>(iterations);
+    result.itemsPerSecond = items / result.secondsPerIteration;
+    return result;
+}
+
+void PrintHeader(const Options& options)
+{
+    if (options.csv)
+        std::printf("name,iterations,ns_per_iteration,items_per_second,unit\n");
+    else
+        std::printf("%-32s %12s %16s %18s\n", "benchmark", "iterations", "time/iter", "throughput");
+}
+
+void PrintResult(const Options& options, const Result& result, const char* unit)
+{
+    const double ns = result.secondsPerIteration * 1e9;
+    if (options.csv)
+    {
+        std::printf("%s,%ld,%.1f,%.6g,%s\n", result.name.c_str(), result.iterations, ns, result.itemsPerSecond, unit);
+        return;
+    }
+    const char* timeUnit = "ns";
+    double time = ns;
+    if (time >= 1e6)
+    {
+        time /= 1e6;
+        timeUnit = "ms";
+    }
+    else if (time >= 1e3)
+    {
+        time /= 1e3;
+        timeUnit = "us";
+    }
+    std::printf("%-32s %12ld %13.2f %s %12.2f M%s\n", result.name.c_str(), result.iterations, time, timeUnit,
+                result.itemsPerSecond / 1e6, unit);
+    std::fflush(stdout);
+}
+
+// Kernel bodies. Each one processes every drop in the store once per
+// iteration; parameters are mild so repeated iterations keep the outlines
+// in a realistic shape.
+void RunKernel(const std::string& kernel, DropStore& store, DropStore& sources, long& tick)
+{
+    const long step = tick++;
+    if (kernel == "marble")
+    {
+        const Drop& source = sources[static_cast<size_t>(step) % sources.Size()];
+        for (Drop& drop : store)
+            drop.marble(source);
+    }
+    else if (kernel == "applyVerticalTine")
+    {
+        const float x = std::fmod(static_cast<float>(step) * 97.0f, kCanvasWidth);
+        for (Drop& drop : store)
+            drop.applyVerticalTine(x, 2.0f, 40.0f);
+    }
+    else if (kernel == "applyTineSegments")
+    {
+        // A four-segment diagonal stroke that walks over the canvas.
+        MarbleOp ops[4];
+        const float x = std::fmod(static_cast<float>(step) * 97.0f, kCanvasWidth);
+        for (int i = 0; i < 4; ++i)
+        {
+            ops[i].kind = MarbleOp::TineSegment;
+            ops[i].x = x + 30.0f * static_cast<float>(i);
+            ops[i].y = 20.0f * static_cast<float>(i);
+            ops[i].x1 = ops[i].x + 30.0f;
+            ops[i].y1 = ops[i].y + 20.0f;
+            ops[i].strength = 2.0f;
+            ops[i].sharpness = 40.0f;
+        }
+        for (Drop& drop : store)
+            drop.applyTineSegments(ops, 4);
+    }
+    else if (kernel == "applyRake")
+    {
+        // A 40-tine comb, 30 px apart, pulled down across the canvas.
+        MarbleOp op;
+        op.kind = MarbleOp::Rake;
+        op.x = std::fmod(static_cast<float>(step) * 97.0f, kCanvasWidth);
+        op.y = 0.5f * kCanvasHeight;
+        op.x1 = 0.0f;
+        op.y1 = 1.0f;
+        op.tines = 40;
+        op.spacing = 30.0f;
+        op.strength = 2.0f;
+        op.sharpness = 12.0f;
+        for (Drop& drop : store)
+            drop.applyRake(op);
+    }
+    else if (kernel == "applyEdgeNoise")
+    {
+        const float time = static_cast<float>(step) / 60.0f;
+        for (Drop& drop : store)
+            drop.applyEdgeNoise(0.05f, 6.0f, time);
+    }
+    else if (kernel == "animateShape")
+    {
+        const float time = static_cast<float>(step) / 60.0f;
+        for (Drop& drop : store)
+            drop.animateShape(time, 0.05f, 2.0f, 3);
+    }
+    else if (kernel == "replayExact" || kernel == "replayFarField")
+    {
+        // One click replayed through applyOps at a spot that walks over the
+        // canvas, exact or with the default far-field tolerance of the scene.
+        MarbleOp op;
+        op.x = std::fmod(static_cast<float>(step) * 397.0f, kCanvasWidth);
+        op.y = std::fmod(static_cast<float>(step) * 211.0f, kCanvasHeight);
+        op.radius = 40.0f;
+        const float tolerance = kernel == "replayFarField" ? kFarFieldTolerance : 0.0f;
+        for (Drop& drop : store)
+            drop.applyOps(&op, 1, tolerance);
+    }
+    else if (kernel == "updateColor")
+    {
+        // A tiny step keeps the blend far from its plateau for millions of
+        // calls, so every call does the full update.
+        for (Drop& drop : store)
+            drop.updateColor(1e-7f);
+    }
+}
+
+void PrintUsage()
+{
+    std::printf("usage: suminasashi_bench [--min-time <seconds>] [--csv] [filter]\n");
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+        {
+            options.minTime = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--csv") == 0)
+        {
+            options.csv = true;
+        }
+        else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0)
+        {
+            PrintUsage();
+            return 0;
+        }
+        else
+        {
+            options.filter = argv[i];
+        }
+    }
+
+    PrintHeader(options);
+    auto selected = [&options](const std::string& name)
+    { return options.filter.empty() || name.find(options.filter) != std::string::npos; };
+
+    // Constructor: building a full scene from scratch, pool growth included
+    // on the first pass and amortized (Clear keeps capacity) afterwards.
+    for (int vertices : kVertexCounts)
+    {
+        for (int drops : kDropCounts)
+        {
+            const std::string name = "construct/" + std::to_string(vertices) + "/" + std::to_string(drops);
+            if (!selected(name) || static_cast<size_t>(vertices) * drops > kMaxTotalVertices)
+                continue;
+            DropStore store;
+            const Result result = Measure(name, static_cast<double>(vertices) * drops, options.minTime, [&]()
+                                          {
+                store.Clear();
+                for (int i = 0; i < drops; ++i)
+                {
+                    store.Emplace(static_cast<float>(i % 1920), static_cast<float>(i % 1080), color(), 40.0, vertices);
+                } });
+            PrintResult(options, result, "vert/s");
+        }
+    }
+
+    const char* kernels[] = {"marble", "replayExact", "replayFarField", "applyVerticalTine", "applyTineSegments", "applyRake", "applyEdgeNoise", "animateShape", "updateColor"};
+    for (const char* kernel : kernels)
+    {
+        const bool perDrop = std::strcmp(kernel, "updateColor") == 0;
+        for (int vertices : kVertexCounts)
+        {
+            for (int drops : kDropCounts)
+            {
+                const std::string name = std::string(kernel) + "/" + std::to_string(vertices) + "/" + std::to_string(drops);
+                if (!selected(name) || static_cast<size_t>(vertices) * drops > kMaxTotalVertices)
+                    continue;
+                // updateColor does not depend on the vertex count; one column is enough.
+                if (perDrop && vertices != kVertexCounts[0])
+                    continue;
+                std::unique_ptr<DropStore> store = MakeScene(vertices, drops);
+                std::unique_ptr<DropStore> sources = MakeScene(16, 8);
+                if (perDrop)
+                {
+                    for (Drop& drop : *store)
+                        drop.setTargetColor(color(20, 40, 200, 255), 1.0f);
+                }
+                long tick = 0;
+                const double items = perDrop ? drops : static_cast<double>(vertices) * drops;
+                const Result result = Measure(name, items, options.minTime, [&]()
+                                              { RunKernel(kernel, *store, *sources, tick); });
+                PrintResult(options, result, perDrop ? "drop/s" : "vert/s");
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "cpu_raster.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Sub-scanlines per pixel row.
+constexpr int kSubsamples = 4;
+} // namespace
+
+CpuCanvas::CpuCanvas(int width, int height)
+    : width(std::max(width, 1)),
+      height(std::max(height, 1)),
+      pixels(static_cast<size_t>(this->width) * this->height * 4, 0),
+      coverage(static_cast<size_t>(this->width) + 1, 0.0f),
+      runs(static_cast<size_t>(this->width) + 1, 0.0f)
+{
+}
+
+void CpuCanvas::Clear(Color c)
+{
+    for (size_t i = 0; i < pixels.size(); i += 4)
+    {
+        pixels[i] = c.r;
+        pixels[i + 1] = c.g;
+        pixels[i + 2] = c.b;
+        pixels[i + 3] = c.a;
+    }
+}
+
+Image CpuCanvas::AsImage()
+{
+    Image image{};
+    image.data = pixels.data();
+    image.width = width;
+    image.height = height;
+    image.mipmaps = 1;
+    image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    return image;
+}
+
+void CpuCanvas::AddSpan(float x0, float x1, float weight)
+{
+    x0 = std::clamp(x0, 0.0f, static_cast<float>(width));
+    x1 = std::clamp(x1, 0.0f, static_cast<float>(width));
+    if (x1 <= x0)
+    {
+        return;
+    }
+    const int first = static_cast<int>(x0);
+    const int last = static_cast<int>(x1);
+    if (first == last)
+    {
+        coverage[first] += (x1 - x0) * weight;
+        return;
+    }
+    coverage[first] += (static_cast<float>(first + 1) - x0) * weight;
+    runs[first + 1] += weight;
+    runs[last] -= weight;
+    coverage[last] += (x1 - static_cast<float>(last)) * weight;
+}
+
+void CpuCanvas::FillPolygon(const float* xs, const float* ys, int n, Color c)
+{
+    if (n < 3 || c.a == 0)
+    {
+        return;
+    }
+    edges.clear();
+    float minX = xs[0], maxX = xs[0], minY = ys[0], maxY = ys[0];
+    for (int i = 0, j = n - 1; i < n; j = i++)
+    {
+        minX = fminf(minX, xs[i]);
+        maxX = fmaxf(maxX, xs[i]);
+        minY = fminf(minY, ys[i]);
+        maxY = fmaxf(maxY, ys[i]);
+        if (ys[i] == ys[j])
+        {
+            continue;
+        }
+        Edge edge;
+        const bool down = ys[j] < ys[i];
+        const float xa = down ? xs[j] : xs[i];
+        const float ya = down ? ys[j] : ys[i];
+        const float xb = down ? xs[i] : xs[j];
+        const float yb = down ? ys[i] : ys[j];
+        edge.yTop = ya;
+        edge.yBottom = yb;
+        edge.xTop = xa;
+        edge.slope = (xb - xa) / (yb - ya);
+        edge.winding = down ? 1 : -1;
+        edges.push_back(edge);
+    }
+    const int rowBegin = std::max(0, static_cast<int>(floorf(minY)));
+    const int rowEnd = std::min(height, static_cast<int>(ceilf(maxY)) + 1);
+    const int columnBegin = std::max(0, static_cast<int>(floorf(minX)));
+    const int columnEnd = std::min(width, static_cast<int>(ceilf(maxX)) + 1);
+    if (rowBegin >= rowEnd || columnBegin >= columnEnd)
+    {
+        return;
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b)
+              { return a.yTop < b.yTop; });
+
+    const float alpha = static_cast<float>(c.a) / 255.0f;
+    const float weight = 1.0f / kSubsamples;
+    size_t nextEdge = 0;
+    active.clear();
+    for (int row = rowBegin; row < rowEnd; ++row)
+    {
+        for (int s = 0; s < kSubsamples; ++s)
+        {
+            const float y = static_cast<float>(row) + (static_cast<float>(s) + 0.5f) * weight;
+            while (nextEdge < edges.size() && edges[nextEdge].yTop <= y)
+            {
+                active.push_back(static_cast<uint32_t>(nextEdge++));
+            }
+            crossings.clear();
+            for (size_t k = 0; k < active.size();)
+            {
+                const Edge& edge = edges[active[k]];
+                if (edge.yBottom <= y)
+                {
+                    active[k] = active.back();
+                    active.pop_back();
+                    continue;
+                }
+                if (edge.yTop <= y)
+                {
+                    crossings.push_back({edge.xTop + (y - edge.yTop) * edge.slope, edge.winding});
+                }
+                ++k;
+            }
+            std::sort(crossings.begin(), crossings.end(), [](const Crossing& a, const Crossing& b)
+                      { return a.x < b.x; });
+            int winding = 0;
+            for (size_t k = 0; k + 1 < crossings.size(); ++k)
+            {
+                winding += crossings[k].winding;
+                if (winding != 0)
+                {
+                    AddSpan(crossings[k].x, crossings[k + 1].x, weight);
+                }
+            }
+        }
+
+        uint8_t* line = pixels.data() + (static_cast<size_t>(row) * width) * 4;
+        float run = 0.0f;
+        for (int x = columnBegin; x < columnEnd; ++x)
+        {
+            run += runs[x];
+            const float a = fminf(coverage[x] + run, 1.0f) * alpha;
+            coverage[x] = 0.0f;
+            runs[x] = 0.0f;
+            if (a <= 0.0f)
+            {
+                continue;
+            }
+            uint8_t* px = line + static_cast<size_t>(x) * 4;
+            px[0] = static_cast<uint8_t>(px[0] + (c.r - px[0]) * a + 0.5f);
+            px[1] = static_cast<uint8_t>(px[1] + (c.g - px[1]) * a + 0.5f);
+            px[2] = static_cast<uint8_t>(px[2] + (c.b - px[2]) * a + 0.5f);
+            px[3] = static_cast<uint8_t>(px[3] + (255 - px[3]) * a + 0.5f);
+        }
+        runs[columnEnd] = 0.0f;
+        coverage[columnEnd] = 0.0f;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "raylib.h"
+
+#include <cstdint>
+#include <vector>
+
+// Software RGBA8 canvas for rendering without a GL context (headless batch
+// renders). Polygons are filled with the nonzero rule and anti-aliased
+// with a few sub-scanlines per pixel row plus exact horizontal coverage.
+class CpuCanvas
+{
+public:
+    CpuCanvas(int width, int height);
+
+    void Clear(Color c);
+    // Alpha-blend a closed polygon given as n-vertex coordinate streams.
+    void FillPolygon(const float* xs, const float* ys, int n, Color c);
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+    // Image view of the pixels, valid while the canvas lives; do not unload.
+    Image AsImage();
+
+private:
+    struct Edge
+    {
+        float yTop, yBottom; // yTop < yBottom
+        float xTop, slope;   // x at yTop, dx/dy
+        int winding;         // +1 downwards, -1 upwards
+    };
+    struct Crossing
+    {
+        float x;
+        int winding;
+    };
+
+    // Add coverage `weight` for [x0, x1) of the current row.
+    void AddSpan(float x0, float x1, float weight);
+
+    int width;
+    int height;
+    std::vector<uint8_t> pixels;
+    std::vector<Edge> edges;
+    std::vector<uint32_t> active;
+    std::vector<Crossing> crossings;
+    // Per-row coverage: partial pixels in `coverage`, whole-pixel runs as a
+    // difference array in `runs` (prefix-summed when the row is blended).
+    std::vector<float> coverage;
+    std::vector<float> runs;
+};
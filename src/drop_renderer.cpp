@@ -0,0 +1,608 @@
+#include "drop_renderer.h"
+
+#include "job_system.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include "triangulate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+namespace
+{
+// Slots get this much headroom so small outline growth (remeshing, tines)
+// does not shift every later slot.
+constexpr float kSlotHeadroom = 1.25f;
+constexpr uint32_t kSlotQuantum = 48;
+constexpr size_t kInitialBufferVertices = 1 << 16;
+// Dirty spans closer than this are uploaded as one range.
+constexpr uint32_t kMergeGap = 256;
+// Compact vertices store coordinates in units of 1/kQuantScale px.
+constexpr float kQuantScale = 4.0f;
+// rlgl only names the byte and float attribute types.
+constexpr int kGlShort = 0x1402;
+
+int16_t Quantize(float value)
+{
+    return static_cast<int16_t>(std::clamp(std::lrint(value * kQuantScale), -32768L, 32767L));
+}
+
+// GLSL 100 for WebGL, 330 core for desktop GL; the bodies are shared.
+#if defined(__EMSCRIPTEN__)
+constexpr const char* kVertexHeader = "#version 100\n#define IN attribute\n#define OUT varying\n";
+constexpr const char* kFragmentHeader = "#version 100\nprecision mediump float;\n#define IN varying\n"
+                                        "#define finalColor gl_FragColor\n";
+#else
+constexpr const char* kVertexHeader = "#version 330\n#define IN in\n#define OUT out\n";
+constexpr const char* kFragmentHeader = "#version 330\n#define IN in\nout vec4 finalColor;\n";
+#endif
+
+// Outline vertices are the committed (base) shape; the vertex shader adds
+// the per-frame radial deformation of Drop::deform (noise plus ripple).
+// vertexDrop is (center, radius); radius 0 marks fan centers, which do not
+// move. Both are multiplied by `quantize` (1 for float vertices, the
+// quantization step for compact ones). The noise hash is a float one because GLSL 100 has no unsigned
+// integers, so its pattern differs from the CPU's.
+constexpr const char* kVertexBody = R"(
+IN vec2 vertexPosition;
+IN vec3 vertexDrop;
+IN vec4 vertexColor;
+uniform mat4 mvp;
+uniform float time;
+uniform vec4 deform; // noise amplitude, noise frequency, ripple amplitude, ripple speed
+uniform int harmonics;
+uniform float quantize;
+OUT vec4 fragColor;
+const float PI = 3.14159265;
+
+float lattice(vec2 p)
+{
+    return fract(sin(dot(p, vec2(127.1, 311.7))) * 43758.5453);
+}
+
+float valueNoise(vec2 p)
+{
+    vec2 i = floor(p);
+    vec2 f = p - i;
+    vec2 s = f * f * (3.0 - 2.0 * f);
+    float a = mix(lattice(i), lattice(i + vec2(1.0, 0.0)), s.x);
+    float b = mix(lattice(i + vec2(0.0, 1.0)), lattice(i + vec2(1.0, 1.0)), s.x);
+    return mix(a, b, s.y);
+}
+
+void main()
+{
+    vec3 drop = vertexDrop * quantize;
+    vec2 center = drop.xy;
+    vec2 position = vertexPosition * quantize;
+    vec2 d = position - center;
+    float r = length(d);
+    if (drop.z > 0.0 && r > 1e-4)
+    {
+        float ang = atan(d.y, d.x);
+        float noise = valueNoise(vec2((ang + PI) / (2.0 * PI) * deform.y, time * 0.35)) * 2.0 - 1.0;
+        float ripple = 0.0;
+        for (int h = 1; h <= 5; ++h)
+        {
+            if (h > harmonics)
+                break;
+            float fh = float(h);
+            ripple += sin(ang * fh + time * deform.w * (0.4 + 0.2 * fh)) / fh;
+        }
+        ripple *= deform.z / float(harmonics);
+        position = center + d * ((r + drop.z * (noise * deform.x + ripple)) / r);
+    }
+    fragColor = vertexColor;
+    gl_Position = mvp * vec4(position, 0.0, 1.0);
+}
+)";
+constexpr const char* kFragmentBody = R"(
+IN vec4 fragColor;
+void main()
+{
+    finalColor = fragColor;
+}
+)";
+} // namespace
+
+uint32_t DropRenderer::CapacityFor(uint32_t vertices)
+{
+    const uint32_t padded = static_cast<uint32_t>(static_cast<float>(vertices) * kSlotHeadroom);
+    return (padded + kSlotQuantum - 1) / kSlotQuantum * kSlotQuantum;
+}
+
+bool DropRenderer::AnimatesOnGpu()
+{
+    return EnsureGpu();
+}
+
+bool DropRenderer::EnsureGpu()
+{
+    if (shader != 0)
+    {
+        return true;
+    }
+    if (gpuFailed)
+    {
+        return false;
+    }
+    const std::string vertexCode = std::string(kVertexHeader) + kVertexBody;
+    const std::string fragmentCode = std::string(kFragmentHeader) + kFragmentBody;
+    shader = rlLoadShaderCode(vertexCode.c_str(), fragmentCode.c_str());
+    if (shader == 0)
+    {
+        std::cout << "[renderer] drop shader failed to compile, using immediate mode" << std::endl;
+        gpuFailed = true;
+        return false;
+    }
+    mvpLoc = rlGetLocationUniform(shader, "mvp");
+    timeLoc = rlGetLocationUniform(shader, "time");
+    deformLoc = rlGetLocationUniform(shader, "deform");
+    harmonicsLoc = rlGetLocationUniform(shader, "harmonics");
+    quantizeLoc = rlGetLocationUniform(shader, "quantize");
+    positionLoc = rlGetLocationAttrib(shader, "vertexPosition");
+    dropLoc = rlGetLocationAttrib(shader, "vertexDrop");
+    colorLoc = rlGetLocationAttrib(shader, "vertexColor");
+
+    CreateBuffer();
+    return true;
+}
+
+void DropRenderer::CreateBuffer()
+{
+    // WebGL 1 without OES_vertex_array_object returns 0 here; attributes are
+    // then bound on every draw instead.
+    vao = rlLoadVertexArray();
+    rlEnableVertexArray(vao);
+    if (compact)
+    {
+        // No mirror to fill it from: every slot is rewritten on its next draw.
+        gpuVertices = std::max({kInitialBufferVertices, gpuVertices, static_cast<size_t>(used)});
+        vbo = rlLoadVertexBuffer(nullptr, static_cast<int>(gpuVertices * sizeof(PackedVertex)), true);
+        for (Slot& slot : slots)
+        {
+            slot.revision = 0;
+        }
+    }
+    else
+    {
+        gpuVertices = std::max(kInitialBufferVertices, mirror.size());
+        mirror.resize(gpuVertices);
+        vbo = rlLoadVertexBuffer(mirror.data(), static_cast<int>(gpuVertices * sizeof(Vertex)), true);
+    }
+    BindBuffer();
+    rlDisableVertexArray();
+    // Slots written before the buffer existed are already in the mirror.
+    dirty.clear();
+}
+
+void DropRenderer::BindBuffer()
+{
+    rlEnableVertexBuffer(vbo);
+    if (compact)
+    {
+        rlSetVertexAttribute(static_cast<unsigned int>(positionLoc), 2, kGlShort, false, sizeof(PackedVertex),
+                             reinterpret_cast<const void*>(offsetof(PackedVertex, x)));
+        rlSetVertexAttribute(static_cast<unsigned int>(dropLoc), 3, kGlShort, false, sizeof(PackedVertex),
+                             reinterpret_cast<const void*>(offsetof(PackedVertex, cx)));
+        rlSetVertexAttribute(static_cast<unsigned int>(colorLoc), 4, RL_UNSIGNED_BYTE, true, sizeof(PackedVertex),
+                             reinterpret_cast<const void*>(offsetof(PackedVertex, r)));
+    }
+    else
+    {
+        rlSetVertexAttribute(static_cast<unsigned int>(positionLoc), 2, RL_FLOAT, false, sizeof(Vertex),
+                             reinterpret_cast<const void*>(offsetof(Vertex, x)));
+        rlSetVertexAttribute(static_cast<unsigned int>(dropLoc), 3, RL_FLOAT, false, sizeof(Vertex),
+                             reinterpret_cast<const void*>(offsetof(Vertex, cx)));
+        rlSetVertexAttribute(static_cast<unsigned int>(colorLoc), 4, RL_UNSIGNED_BYTE, true, sizeof(Vertex),
+                             reinterpret_cast<const void*>(offsetof(Vertex, r)));
+    }
+    rlEnableVertexAttribute(static_cast<unsigned int>(positionLoc));
+    rlEnableVertexAttribute(static_cast<unsigned int>(dropLoc));
+    rlEnableVertexAttribute(static_cast<unsigned int>(colorLoc));
+}
+
+void DropRenderer::AppendSlots(const DropStore& drops)
+{
+    while (slots.size() < drops.Size())
+    {
+        const Drop& drop = drops[slots.size()];
+        Slot slot;
+        slot.first = used;
+        slot.capacity = drop.isRetired() ? 0 : CapacityFor(3u * static_cast<uint32_t>(drop.getVertexCount()));
+        used += slot.capacity;
+        slots.push_back(slot);
+    }
+    if (!compact && mirror.size() < used)
+    {
+        mirror.resize(std::max<size_t>(used, mirror.size() * 2));
+    }
+}
+
+void DropRenderer::GrowSlot(size_t index, uint32_t vertices)
+{
+    // Shift every later slot up; their contents move with them in the
+    // mirror, so they only need re-uploading, not rewriting.
+    const uint32_t capacity = CapacityFor(vertices);
+    const uint32_t shift = capacity - slots[index].capacity;
+    const uint32_t tail = slots[index].first + slots[index].capacity;
+    if (compact)
+    {
+        // Nothing to move on the CPU; shifted slots are rewritten when next
+        // drawn, and until then they are not part of any draw run.
+        for (size_t i = index + 1; i < slots.size(); ++i)
+        {
+            slots[i].first += shift;
+            slots[i].revision = 0;
+        }
+        slots[index].capacity = capacity;
+        slots[index].revision = 0;
+        used += shift;
+        return;
+    }
+    if (mirror.size() < used + shift)
+    {
+        mirror.resize(std::max<size_t>(used + shift, mirror.size() * 2));
+    }
+    std::copy_backward(mirror.begin() + tail, mirror.begin() + used, mirror.begin() + used + shift);
+    for (size_t i = index + 1; i < slots.size(); ++i)
+    {
+        slots[i].first += shift;
+    }
+    slots[index].capacity = capacity;
+    slots[index].revision = 0;
+    used += shift;
+    MarkDirty(tail + shift, used);
+}
+
+void DropRenderer::Triangulate(Slot& slot, const Drop& drop)
+{
+    const int n = drop.getVertexCount();
+    const Vector2 c = drop.getCenter();
+    slot.baseRevision = drop.getBaseRevision();
+    slot.triangles.clear();
+    if (n >= 3 && !IsStarShapedFrom(drop.getBaseX(), drop.getBaseY(), n, c.x, c.y))
+    {
+        TriangulatePolygon(drop.getBaseX(), drop.getBaseY(), n, slot.triangles);
+    }
+}
+
+template <typename V>
+void DropRenderer::FillSlot(const Slot& slot, const Drop& drop, V* out)
+{
+    const int n = drop.getVertexCount();
+    const uint32_t rgba = drop.getPackedColor();
+    const unsigned char r = static_cast<unsigned char>(rgba >> 24);
+    const unsigned char g = static_cast<unsigned char>(rgba >> 16);
+    const unsigned char b = static_cast<unsigned char>(rgba >> 8);
+    const unsigned char a = static_cast<unsigned char>(rgba);
+    const Vector2 c = drop.getCenter();
+    const float radius = static_cast<float>(drop.getRadius());
+    // The committed outline; the shader animates it.
+    const float* xs = drop.getBaseX();
+    const float* ys = drop.getBaseY();
+
+    auto vertex = [&](float x, float y, float rad, unsigned char alpha)
+    {
+        if constexpr (std::is_same_v<V, PackedVertex>)
+            return PackedVertex{Quantize(x), Quantize(y), Quantize(c.x), Quantize(c.y), Quantize(rad), 0, r, g, b, alpha};
+        else
+            return Vertex{x, y, c.x, c.y, rad, r, g, b, alpha};
+    };
+    uint32_t written = 0;
+    if (!slot.triangles.empty())
+    {
+        for (const uint32_t v : slot.triangles)
+        {
+            out[written++] = vertex(xs[v], ys[v], radius, a);
+        }
+    }
+    else if (n >= 3)
+    {
+        // Star-shaped: same fan and winding as Drop::Draw_drops.
+        const V hub = vertex(c.x, c.y, 0.0f, a);
+        for (int i = 0; i < n; ++i)
+        {
+            const int j = (i + 1) % n;
+            out[written++] = hub;
+            out[written++] = vertex(xs[j], ys[j], radius, a);
+            out[written++] = vertex(xs[i], ys[i], radius, a);
+        }
+    }
+    // Collapse the unused tail onto one point so whole runs of slots can be
+    // drawn with a single call.
+    std::fill(out + written, out + slot.capacity, vertex(c.x, c.y, 0.0f, 0));
+}
+
+void DropRenderer::WriteSlot(size_t index, const Drop& drop)
+{
+    Slot& slot = slots[index];
+    FillSlot(slot, drop, mirror.data() + slot.first);
+    slot.revision = drop.getRevision();
+    MarkDirty(slot.first, slot.first + slot.capacity);
+}
+
+void DropRenderer::WritePackedSlot(size_t index, const Drop& drop)
+{
+    Slot& slot = slots[index];
+    if (packed.empty() || packedFirst + packed.size() != slot.first)
+    {
+        FlushPacked();
+        packedFirst = slot.first;
+    }
+    const size_t at = packed.size();
+    packed.resize(at + slot.capacity);
+    FillSlot(slot, drop, packed.data() + at);
+    slot.revision = drop.getRevision();
+}
+
+void DropRenderer::FlushPacked()
+{
+    if (packed.empty())
+    {
+        return;
+    }
+    const size_t bytes = packed.size() * sizeof(PackedVertex);
+    rlUpdateVertexBuffer(vbo, packed.data(), static_cast<int>(bytes), static_cast<int>(packedFirst * sizeof(PackedVertex)));
+    uploadBytes += bytes;
+    packed.clear();
+}
+
+void DropRenderer::MarkDirty(uint32_t first, uint32_t end)
+{
+    if (first >= end)
+    {
+        return;
+    }
+    if (!dirty.empty() && first <= dirty.back().end + kMergeGap && end + kMergeGap >= dirty.back().first)
+    {
+        dirty.back().first = std::min(dirty.back().first, first);
+        dirty.back().end = std::max(dirty.back().end, end);
+        return;
+    }
+    dirty.push_back({first, end});
+}
+
+void DropRenderer::Upload()
+{
+    uploadBytes = 0;
+    if (mirror.size() > gpuVertices)
+    {
+        // Reallocate and send everything; the old contents are all in the mirror.
+        rlUnloadVertexBuffer(vbo);
+        gpuVertices = mirror.size();
+        rlEnableVertexArray(vao);
+        vbo = rlLoadVertexBuffer(mirror.data(), static_cast<int>(gpuVertices * sizeof(Vertex)), true);
+        BindBuffer();
+        rlDisableVertexArray();
+        uploadBytes = used * sizeof(Vertex);
+        dirty.clear();
+        return;
+    }
+    for (const Span& span : dirty)
+    {
+        const size_t bytes = (span.end - span.first) * sizeof(Vertex);
+        rlUpdateVertexBuffer(vbo, mirror.data() + span.first, static_cast<int>(bytes),
+                             static_cast<int>(span.first * sizeof(Vertex)));
+        uploadBytes += bytes;
+    }
+    dirty.clear();
+}
+
+void DropRenderer::Draw(const DropStore& drops, const std::vector<uint32_t>& visible, const DropAnimation& animation)
+{
+    drawCalls = 0;
+    if (!EnsureGpu())
+    {
+        for (const uint32_t index : visible)
+        {
+            drops[index].Draw_drops();
+        }
+        return;
+    }
+    if (drops.Size() < slots.size())
+    {
+        Reset();
+    }
+    AppendSlots(drops);
+
+    // Outlines committed since their slot was last written get a new
+    // triangulation; ear clipping is the expensive part, so it is spread
+    // over the job system.
+    retriangulate.clear();
+    for (const uint32_t index : visible)
+    {
+        if (slots[index].baseRevision != drops[index].getBaseRevision())
+        {
+            retriangulate.push_back(index);
+        }
+    }
+    JobSystem::Instance().ParallelFor(retriangulate.size(), 1, [this, &drops](size_t begin, size_t end)
+                                      {
+        for (size_t k = begin; k < end; ++k)
+        {
+            Triangulate(slots[retriangulate[k]], drops[retriangulate[k]]);
+        } });
+
+    // Make room first, then write: growing shifts later slots, and in
+    // compact mode a larger buffer invalidates every slot.
+    for (const uint32_t index : visible)
+    {
+        const Drop& drop = drops[index];
+        const uint32_t need = 3u * static_cast<uint32_t>(drop.getVertexCount());
+        if (slots[index].revision != drop.getRevision() && need > slots[index].capacity)
+        {
+            GrowSlot(index, need);
+        }
+    }
+    uploadBytes = 0;
+    if (compact && used > gpuVertices)
+    {
+        rlUnloadVertexArray(vao);
+        rlUnloadVertexBuffer(vbo);
+        gpuVertices = std::max<size_t>(used, gpuVertices * 2);
+        CreateBuffer();
+    }
+    for (const uint32_t index : visible)
+    {
+        const Drop& drop = drops[index];
+        if (slots[index].revision == drop.getRevision())
+        {
+            continue;
+        }
+        if (compact)
+        {
+            WritePackedSlot(index, drop);
+        }
+        else
+        {
+            WriteSlot(index, drop);
+        }
+    }
+    if (compact)
+    {
+        FlushPacked();
+    }
+    else
+    {
+        Upload();
+    }
+    if (visible.empty())
+    {
+        return;
+    }
+
+    rlDrawRenderBatchActive();
+    rlEnableShader(shader);
+    rlSetUniformMatrix(mvpLoc, MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection()));
+    const float deform[4] = {animation.noiseAmplitude, animation.noiseFrequency, animation.rippleAmplitude,
+                             animation.rippleSpeed};
+    const int harmonics = std::clamp(animation.harmonics, 1, 5);
+    rlSetUniform(timeLoc, &animation.time, RL_SHADER_UNIFORM_FLOAT, 1);
+    rlSetUniform(deformLoc, deform, RL_SHADER_UNIFORM_VEC4, 1);
+    rlSetUniform(harmonicsLoc, &harmonics, RL_SHADER_UNIFORM_INT, 1);
+    const float quantize = compact ? 1.0f / kQuantScale : 1.0f;
+    rlSetUniform(quantizeLoc, &quantize, RL_SHADER_UNIFORM_FLOAT, 1);
+    if (!rlEnableVertexArray(vao))
+    {
+        BindBuffer();
+    }
+    // Slots of hidden drops may hold stale geometry, so a run only extends
+    // over slots that are visible or empty (retired drops).
+    uint32_t runFirst = slots[visible[0]].first;
+    uint32_t runEnd = runFirst + slots[visible[0]].capacity;
+    for (size_t k = 1; k <= visible.size(); ++k)
+    {
+        if (k < visible.size() && slots[visible[k]].first == runEnd)
+        {
+            runEnd += slots[visible[k]].capacity;
+            continue;
+        }
+        if (runEnd > runFirst)
+        {
+            rlDrawVertexArray(static_cast<int>(runFirst), static_cast<int>(runEnd - runFirst));
+            ++drawCalls;
+        }
+        if (k < visible.size())
+        {
+            runFirst = slots[visible[k]].first;
+            runEnd = runFirst + slots[visible[k]].capacity;
+        }
+    }
+    rlDisableVertexArray();
+    rlDisableVertexBuffer();
+    rlDisableShader();
+}
+
+void DropRenderer::Reset()
+{
+    slots.clear();
+    dirty.clear();
+    used = 0;
+}
+
+void DropRenderer::ErasePrefix(size_t count)
+{
+    count = std::min(count, slots.size());
+    if (count == 0)
+    {
+        return;
+    }
+    const uint32_t shift = count < slots.size() ? slots[count].first : used;
+    if (!compact)
+    {
+        std::copy(mirror.begin() + shift, mirror.begin() + used, mirror.begin());
+    }
+    slots.erase(slots.begin(), slots.begin() + static_cast<std::ptrdiff_t>(count));
+    for (Slot& slot : slots)
+    {
+        slot.first -= shift;
+        if (compact)
+        {
+            slot.revision = 0;
+        }
+    }
+    used -= shift;
+    dirty.clear();
+    if (!compact)
+    {
+        MarkDirty(0, used);
+    }
+}
+
+void DropRenderer::Truncate(size_t count)
+{
+    if (count >= slots.size())
+    {
+        return;
+    }
+    used = slots[count].first;
+    slots.resize(count);
+}
+
+void DropRenderer::SetCompact(bool on)
+{
+    if (on == compact)
+    {
+        return;
+    }
+    compact = on;
+    Reset();
+    packed.clear();
+    if (compact)
+    {
+        // The mirror is most of the renderer's heap; give it back.
+        std::vector<Vertex>().swap(mirror);
+    }
+    if (shader != 0)
+    {
+        rlUnloadVertexArray(vao);
+        rlUnloadVertexBuffer(vbo);
+        gpuVertices = 0;
+        CreateBuffer();
+    }
+}
+
+void DropRenderer::Unload()
+{
+    if (vao != 0)
+    {
+        rlUnloadVertexArray(vao);
+    }
+    if (vbo != 0)
+    {
+        rlUnloadVertexBuffer(vbo);
+    }
+    if (shader != 0)
+    {
+        rlUnloadShaderProgram(shader);
+    }
+    vao = 0;
+    vbo = 0;
+    shader = 0;
+    gpuVertices = 0;
+    Reset();
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "drop_store.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Draws drops from one persistent vertex buffer instead of pushing every
+// triangle through rlgl's immediate mode each frame. Each drop owns a slot of
+// triangles in the buffer (a fan, or an ear-clipped triangulation once
+// marbling makes the outline concave around its center), laid out in drop
+// (paint) order. Slots hold the committed outline and the vertex shader
+// animates it, so a slot is only rewritten and re-uploaded when the drop's
+// revision changes, and runs of visible drops whose slots are adjacent go
+// out in a single draw call.
+//
+// In compact mode vertices are 16-byte records with coordinates quantized to
+// quarter pixels in int16 (screen range about +-8192 px), and no CPU mirror
+// is kept: slots are written straight into the upload and re-derived from
+// their drops when the buffer is reallocated or slots shift.
+//
+// GPU objects are created on the first Draw() and must be released with
+// Unload() while the GL context is still alive.
+class DropRenderer
+{
+public:
+    DropRenderer() = default;
+    ~DropRenderer() = default;
+    DropRenderer(const DropRenderer&) = delete;
+    DropRenderer& operator=(const DropRenderer&) = delete;
+
+    // True once the shader path is available. Otherwise Draw() falls back
+    // to Drop::Draw_drops and the caller must deform drops on the CPU.
+    bool AnimatesOnGpu();
+    // Draw `visible` (ascending drop indices) from `drops`. Flushes rlgl's
+    // pending batch first so earlier immediate-mode drawing stays underneath.
+    void Draw(const DropStore& drops, const std::vector<uint32_t>& visible, const DropAnimation& animation);
+    // Forget every slot, e.g. after the scene was cleared.
+    void Reset();
+    // Drop the slots of the first `count` drops after the scene evicted
+    // them. Later slots keep their contents and move down in the buffer.
+    void ErasePrefix(size_t count);
+    // Drop the slots of drops from index `count` on after the scene removed
+    // them (undo). Earlier slots are untouched.
+    void Truncate(size_t count);
+    void Unload();
+    // Switch vertex format; every slot is rewritten on its next draw.
+    void SetCompact(bool compact);
+    bool IsCompact() const { return compact; }
+
+    size_t LastDrawCalls() const { return drawCalls; }
+    size_t LastUploadBytes() const { return uploadBytes; }
+    // CPU memory held for vertex data (mirror and staging), in bytes.
+    size_t HeapBytes() const { return mirror.capacity() * sizeof(Vertex) + packed.capacity() * sizeof(PackedVertex); }
+
+private:
+    struct Vertex
+    {
+        float x, y;
+        float cx, cy, radius;
+        unsigned char r, g, b, a;
+    };
+    // Compact vertex: the same fields in int16 quarter pixels.
+    struct PackedVertex
+    {
+        int16_t x, y;
+        int16_t cx, cy, radius, pad;
+        unsigned char r, g, b, a;
+    };
+    struct Slot
+    {
+        uint32_t first = 0;    // first vertex in the buffer
+        uint32_t capacity = 0; // vertices reserved; the unused tail is degenerate
+        uint32_t revision = 0; // drop revision the slot was written for, 0 = never
+        uint32_t baseRevision = 0;
+        // Cached triangulation of the committed outline; empty while a fan
+        // from the center covers it correctly.
+        std::vector<uint32_t> triangles;
+    };
+    struct Span
+    {
+        uint32_t first, end;
+    };
+
+    bool EnsureGpu();
+    void CreateBuffer();
+    void AppendSlots(const DropStore& drops);
+    void GrowSlot(size_t index, uint32_t vertices);
+    static void Triangulate(Slot& slot, const Drop& drop);
+    template <typename V>
+    static void FillSlot(const Slot& slot, const Drop& drop, V* out);
+    void WriteSlot(size_t index, const Drop& drop);
+    void WritePackedSlot(size_t index, const Drop& drop);
+    void FlushPacked();
+    void MarkDirty(uint32_t first, uint32_t end);
+    void Upload();
+    void BindBuffer();
+    size_t VertexBytes() const { return compact ? sizeof(PackedVertex) : sizeof(Vertex); }
+    static uint32_t CapacityFor(uint32_t vertices);
+
+    std::vector<Slot> slots;
+    // CPU copy of the whole buffer; slots are written here and dirty spans
+    // are copied to the GPU once per frame.
+    std::vector<Vertex> mirror;
+    std::vector<Span> dirty;
+    // Compact mode: consecutive slots written this frame, uploaded as one
+    // range starting at packedFirst.
+    bool compact = false;
+    std::vector<PackedVertex> packed;
+    uint32_t packedFirst = 0;
+    std::vector<uint32_t> retriangulate;
+    uint32_t used = 0;
+
+    unsigned int shader = 0;
+    int mvpLoc = -1;
+    int timeLoc = -1;
+    int deformLoc = -1;
+    int harmonicsLoc = -1;
+    int quantizeLoc = -1;
+    int positionLoc = 0;
+    int dropLoc = -1;
+    int colorLoc = 3;
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+    size_t gpuVertices = 0;
+    bool gpuFailed = false;
+
+    size_t drawCalls = 0;
+    size_t uploadBytes = 0;
+};
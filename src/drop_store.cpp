@@ -0,0 +1,139 @@
+#include "drop_store.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+// Enough for a few hundred default-sized drops before the first growth.
+constexpr size_t kInitialDrops = 256;
+constexpr size_t kInitialPoolFloats = kInitialDrops * DropStore::kStreamsPerDrop * 208;
+// Freed space below this is not worth a compaction pass.
+constexpr size_t kMinCompactFloats = 1 << 16;
+} // namespace
+
+DropStore::DropStore()
+{
+    drops.reserve(kInitialDrops);
+    pool.resize(kInitialPoolFloats);
+}
+
+Drop& DropStore::Emplace(float x, float y, color clr, double radius, int n)
+{
+    drops.emplace_back(*this, x, y, clr, radius, n);
+    return drops.back();
+}
+
+void DropStore::Clear()
+{
+    // Drop is trivially destructible, so this does not walk the drops; the
+    // pool keeps its size and is simply rewound.
+    drops.clear();
+    used = 0;
+    garbage = 0;
+}
+
+void DropStore::SetCompact(bool compact)
+{
+    const uint32_t target = compact ? kCompactStreamsPerDrop : kStreamsPerDrop;
+    if (target == streams)
+    {
+        return;
+    }
+    size_t need = 0;
+    for (const Drop& drop : drops)
+    {
+        need += static_cast<size_t>(drop.getPoolStride()) * target;
+    }
+    std::vector<float> next(std::max(need, kInitialPoolFloats * target / kStreamsPerDrop));
+    size_t write = 0;
+    for (Drop& drop : drops)
+    {
+        const size_t stride = drop.getPoolStride();
+        if (drop.isRetired() || stride == 0)
+        {
+            continue;
+        }
+        // Both layouts start with x/y streams; the full one needs them twice
+        // (current and base), the committed outline goes in either way.
+        const float* base = drop.getBaseX();
+        std::memcpy(next.data() + write, base, sizeof(float) * 2 * stride);
+        if (target == kStreamsPerDrop)
+        {
+            std::memcpy(next.data() + write + 2 * stride, base, sizeof(float) * 2 * stride);
+        }
+        drop.rebase(static_cast<uint32_t>(write), compact);
+        write += stride * target;
+    }
+    pool.swap(next);
+    used = write;
+    garbage = 0;
+    streams = target;
+}
+
+void DropStore::ErasePrefix(size_t count)
+{
+    drops.erase(drops.begin(), drops.begin() + static_cast<std::ptrdiff_t>(count));
+}
+
+void DropStore::Truncate(size_t count)
+{
+    for (size_t i = count; i < drops.size(); ++i)
+    {
+        drops[i].retire();
+    }
+    drops.erase(drops.begin() + static_cast<std::ptrdiff_t>(std::min(count, drops.size())), drops.end());
+}
+
+uint32_t DropStore::Allocate(uint32_t stride)
+{
+    const size_t need = static_cast<size_t>(stride) * streams;
+    if (used + need > pool.size())
+    {
+        // Geometric growth keeps the number of reallocations (and the holes
+        // they leave in a growing WASM heap) logarithmic in the session size.
+        pool.resize(std::max(pool.size() * 2, used + need));
+    }
+    const uint32_t offset = static_cast<uint32_t>(used);
+    used += need;
+    return offset;
+}
+
+void DropStore::Free(uint32_t, uint32_t stride)
+{
+    garbage.fetch_add(static_cast<size_t>(stride) * streams, std::memory_order_relaxed);
+}
+
+void DropStore::MaybeCompact()
+{
+    const size_t wasted = garbage.load(std::memory_order_relaxed);
+    if (wasted < kMinCompactFloats || wasted * 2 < used)
+    {
+        return;
+    }
+
+    // Visit blocks in pool order so every move is towards lower addresses
+    // and never overwrites a block that has not been moved yet.
+    compactOrder.resize(drops.size());
+    for (size_t i = 0; i < drops.size(); ++i)
+    {
+        compactOrder[i] = static_cast<uint32_t>(i);
+    }
+    std::sort(compactOrder.begin(), compactOrder.end(), [this](uint32_t a, uint32_t b)
+              { return drops[a].getPoolOffset() < drops[b].getPoolOffset(); });
+
+    size_t write = 0;
+    for (const uint32_t index : compactOrder)
+    {
+        Drop& drop = drops[index];
+        const size_t size = static_cast<size_t>(drop.getPoolStride()) * streams;
+        if (drop.getPoolOffset() != write)
+        {
+            std::memmove(pool.data() + write, pool.data() + drop.getPoolOffset(), size * sizeof(float));
+            drop.relocate(static_cast<uint32_t>(write));
+        }
+        write += size;
+    }
+    used = write;
+    garbage = 0;
+}
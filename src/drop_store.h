@@ -0,0 +1,80 @@
+#pragma once
+
+#include "drops.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Owns every drop of a scene together with one contiguous float pool that
+// holds all of their current and base vertices. Drops only keep an offset
+// into the pool, so creating a drop never allocates once the pool has grown
+// to the session's working size, iterating all drops walks memory linearly
+// and Clear() is a constant-time reset that keeps the capacity for reuse.
+class DropStore
+{
+public:
+    DropStore();
+    DropStore(const DropStore&) = delete;
+    DropStore& operator=(const DropStore&) = delete;
+
+    Drop& Emplace(float x, float y, color clr, double radius, int n);
+    void Clear();
+    // Remove the first `count` drops, which must already be retired (their
+    // blocks freed). Later drops move down to lower indices.
+    void ErasePrefix(size_t count);
+    // Remove every drop from index `count` on, releasing their blocks.
+    void Truncate(size_t count);
+
+    // Streams per drop block: current x/y, base x/y and the base outline's
+    // polar cache (angle, radius, cos, sin around the drop center).
+    static constexpr uint32_t kStreamsPerDrop = 8;
+    // Compact layout: one x/y pair that is both the current and the
+    // committed outline. A quarter of the memory per vertex, for targets
+    // where the heap runs out before the frame rate does; drops in a
+    // compact store animate only on the GPU.
+    static constexpr uint32_t kCompactStreamsPerDrop = 2;
+
+    // Switch layouts, moving every live drop's committed outline into a new
+    // pool. Per-frame deformation and polar caches are not carried over.
+    void SetCompact(bool compact);
+    bool IsCompact() const { return streams == kCompactStreamsPerDrop; }
+    uint32_t StreamsPerDrop() const { return streams; }
+
+    // Reserve a block of StreamsPerDrop() streams of `stride` floats each and
+    // return its offset in the pool.
+    uint32_t Allocate(uint32_t stride);
+    // Mark a block (or the tail of one) of StreamsPerDrop() * stride floats
+    // as unused. The space is reclaimed by MaybeCompact(). Safe to call from
+    // worker threads, unlike Allocate().
+    void Free(uint32_t offset, uint32_t stride);
+    // Slide live blocks down over freed ones once enough space is wasted.
+    void MaybeCompact();
+    float* Block(uint32_t offset) { return pool.data() + offset; }
+
+    // Stream length for a drop with n vertices. Padded to a multiple of 8 so
+    // each stream starts on a 32-byte boundary relative to the pool.
+    static uint32_t StrideFor(int n) { return (static_cast<uint32_t>(n) + 7u) & ~7u; }
+
+    size_t Size() const { return drops.size(); }
+    bool Empty() const { return drops.empty(); }
+    Drop& operator[](size_t index) { return drops[index]; }
+    const Drop& operator[](size_t index) const { return drops[index]; }
+    std::vector<Drop>::iterator begin() { return drops.begin(); }
+    std::vector<Drop>::iterator end() { return drops.end(); }
+    std::vector<Drop>::const_iterator begin() const { return drops.begin(); }
+    std::vector<Drop>::const_iterator end() const { return drops.end(); }
+
+    size_t PoolFloatsUsed() const { return used; }
+    size_t PoolFloatsCapacity() const { return pool.size(); }
+    size_t PoolFloatsFree() const { return garbage.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<Drop> drops;
+    std::vector<float> pool;
+    size_t used = 0;
+    uint32_t streams = kStreamsPerDrop;
+    std::atomic<size_t> garbage{0};
+    std::vector<uint32_t> compactOrder;
+};
@@ -4,6 +4,7 @@
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <cstdint>
 
 #ifndef PI
 #define PI 3.14159265358979323846
@@ -18,29 +19,163 @@ typedef struct color
     }
 } color;
 
+// Colors packed as 0xRRGGBBAA, the form drops, ops and the event log keep.
+inline uint32_t PackColor(const color& c)
+{
+    return (static_cast<uint32_t>(c.r) & 0xFF) << 24 | (static_cast<uint32_t>(c.g) & 0xFF) << 16 |
+           (static_cast<uint32_t>(c.b) & 0xFF) << 8 | (static_cast<uint32_t>(c.a) & 0xFF);
+}
+
+inline color UnpackColor(uint32_t rgba)
+{
+    return color(static_cast<float>(rgba >> 24), static_cast<float>((rgba >> 16) & 0xFF), static_cast<float>((rgba >> 8) & 0xFF),
+                 static_cast<float>(rgba & 0xFF));
+}
+
+// A recorded scene mutation. The scene logs drop insertions and tines and
+// each drop replays the ones it has not seen yet when its geometry is needed.
+//
+// A TineSegment is one piece of a stylus stroke from (x, y) to (x1, y1).
+// With band and exponent e derived from sharpness as for VerticalTine, a
+// point at distance d from the segment's line and at t along it (0 at the
+// start, L at the end) moves along the segment by
+//   strength * (1 - S(d / band))^e * (S((t + r) / 2r) - S((t - L + r) / 2r))
+// where S is the quintic smoothstep clamped to [0, 1] and r = TineRamp().
+// The last factor is a window that telescopes over consecutive pieces of a
+// straight stroke, so a stroke pushes the points it passes by `strength`
+// however finely it is split, and a long straight stroke is the classic
+// line tine. Ramping the window over at least 1.5 * |strength| keeps each
+// segment a one-to-one map of the plane, which the baked layer and the
+// pixel engine rely on to invert it.
+//
+// A Rake is a comb of `tines` parallel tines `spacing` px apart, centered on
+// (x, y) and pulled along the unit direction (x1, y1). Each tine is an
+// infinite line; a point at distance d_k from tine k moves along the pull by
+//   strength * sum_k (1 - S(d_k / band))^e
+// with band and e as for VerticalTine. The push never changes a point's
+// position across the comb, so the tines add up in one pass.
+struct MarbleOp
+{
+    enum Kind : uint8_t
+    {
+        DropInsert,
+        VerticalTine,
+        TineSegment,
+        Rake
+    };
+    Kind kind = DropInsert;
+    float x = 0.0f, y = 0.0f;   // drop center, tine x (y unused), segment start or comb center
+    float x1 = 0.0f, y1 = 0.0f; // segment end or rake direction
+    float radius = 0.0f;        // drop radius
+    float strength = 0.0f;      // tine strength
+    float sharpness = 0.0f;     // tine sharpness
+    float spacing = 0.0f;       // rake tine spacing
+    uint16_t tines = 0;         // rake tine count
+    uint32_t rgba = 0;          // drop color 0xRRGGBBAA, for per-pixel shading
+};
+
+// Falloff band and exponent of a tine with the given sharpness, before the
+// per-drop cap VerticalTine applies to the band.
+inline float TineBand(float sharpness) { return fmaxf(sharpness, 8.0f); }
+inline float TineExponent(float sharpness) { return 1.0f + fminf(fmaxf(sharpness, 1.0f), 512.0f) / 256.0f * 2.0f; }
+// Length over which a tine segment's push ramps up at its start and down
+// past its end.
+inline float TineRamp(float band, float strength) { return fmaxf(band, 1.5f * fabsf(strength)); }
+
+// Screen-space limits for adaptive resampling of drop outlines after they
+// have been marbled or tined.
+struct RemeshParams
+{
+    bool enabled = true;
+    float maxEdge = 6.0f;    // subdivide edges longer than this (px)
+    float minEdge = 0.75f;   // merge vertices closer than this (px)
+    float flatness = 0.12f;  // drop vertices within this distance of the chord (px)
+    int minVertices = 16;
+    int maxVertices = 2048;
+};
+
+class DropStore;
+
+// Per-frame outline deformation: radial offsets of the committed outline
+// that are added together (value-noise wobble plus a harmonic ripple).
+// Amplitudes are fractions of the drop radius. Evaluated on the CPU by
+// Drop::deform and in the renderer's vertex shader.
+struct DropAnimation
+{
+    float time = 0.0f;
+    float noiseAmplitude = 0.0f;
+    float noiseFrequency = 6.0f;
+    float rippleAmplitude = 0.0f;
+    float rippleSpeed = 2.0f;
+    int harmonics = 3;
+};
+
 class Drop
 {
 private:
     Vector2 center;
     double radius;
-    color clr;
+    uint32_t clr; // 0xRRGGBBAA
     int n;
-    std::vector<Vector2> vertices;
-    // Store the base (original) circular vertices so we can apply time-based
-    // procedural deformations each frame without accumulating floating error.
-    std::vector<Vector2> baseVertices;
+    // Vertex data lives in the owning DropStore's pool. The block at `offset`
+    // holds structure-of-arrays streams of `stride` floats each: current x,
+    // current y, base x, base y, then the polar cache of the base outline.
+    // The base (original) vertices let us apply time-based procedural
+    // deformations each frame without accumulating floating error.
+    // In a compact store the block only has the first two streams: base and
+    // current outline are the same arrays and there is no polar cache, so
+    // per-frame deformation is left to the GPU.
+    DropStore* store = nullptr;
+    uint32_t offset = 0;
+    uint32_t stride = 0;
+    bool compact = false;
+    float* curX() const;
+    float* curY() const { return curX() + stride; }
+    float* baseX() const { return compact ? curX() : curX() + 2 * stride; }
+    float* baseY() const { return compact ? curY() : curX() + 3 * stride; }
+    // Base vertices around `center`: angle (atan2), distance and the angle's
+    // cos/sin. Per-frame deformations only scale the radius, so with these
+    // they need no trigonometry per vertex. Rebuilt lazily after the base or
+    // the center changes.
+    float* polarAngle() const { return curX() + 4 * stride; }
+    float* polarRadius() const { return curX() + 5 * stride; }
+    float* polarCos() const { return curX() + 6 * stride; }
+    float* polarSin() const { return curX() + 7 * stride; }
+    bool polarValid = false;
+    void ensurePolar();
+    // Apply the leading far-field insertions of `ops` as one affine map;
+    // returns how many ops were consumed (0 if the first one is near).
+    size_t applyFarField(const MarbleOp* ops, size_t count, float tolerance);
+    bool isFarFrom(const MarbleOp& op, float slack, float tolerance) const;
+    // Product of the Lipschitz bounds of far-field maps since the last
+    // remesh(), an upper bound on how much they lengthened any edge.
+    float farStretch = 1.0f;
+    // Axis-aligned bounds of the committed geometry (before animation).
+    Rectangle bounds{};
+    // Sequence number of the first scene op this drop has not applied yet.
+    uint32_t opCursor = 0;
+    // Set once the drop is known to be hidden under a later opaque drop; its
+    // vertex block has been released and it no longer takes part in marbling.
+    bool retired = false;
+    // See getRevision() and getBaseRevision().
+    uint32_t revision = 1;
+    uint32_t baseRevision = 0;
+    // Recompute bounds (and optionally re-center on the centroid) from the
+    // current vertices after a permanent geometry change.
+    void refreshShape(bool recenter);
     // Target color to blend toward (optional)
-    color targetClr;
+    uint32_t targetClr = 0;
     bool hasTarget = false;
     // Starting color when a target is assigned
-    color startClr;
+    uint32_t startClr = 0;
     // Accumulated blend factor (0..maxBlend)
     float blendAccum = 0.0f;
     // Maximum fraction toward target (e.g. 0.6 keeps 40% original)
     float maxBlend = 0.6f;
 public:
-    Drop(float x, float y, color clr, double radius = 100, int n = 100);
-    void Draw_drops();
+    // Drops are created through DropStore::Emplace, which owns their vertices.
+    Drop(DropStore& store, float x, float y, color clr, double radius = 100, int n = 100);
+    void Draw_drops() const;
     void update_vertices(float c_x, float c_y, double n_r);
     void wavy_transformation();
     void inserve_wavy_transformation();
@@ -48,10 +183,83 @@ public:
     // (default) the resulting geometry becomes the new base for future
     // procedural (noise/animation) effects.
     void marble(const Drop& other, bool commitBaseShape = true);
+    // Replay recorded ops in order. Runs of consecutive drop insertions are
+    // fused into a single pass over the vertices, and so are runs of tine
+    // segments; vertical tines are applied one by one because their
+    // smoothing step reads neighbouring vertices.
+    // With a positive `farFieldTolerance` (px), runs of insertions far from
+    // the drop are replaced by their composed linearization (see
+    // MarbleLinearize) as long as the bound on the run's error stays within
+    // the tolerance, and applied as one affine pass. Returns true if the
+    // outline should be resampled: an exact op or tine changed its shape, or
+    // far-field maps have stretched it by a few percent since the last
+    // remesh().
+    bool applyOps(const MarbleOp* ops, size_t count, float farFieldTolerance = 0.0f);
+    // Resample the committed outline: subdivide long chords left by
+    // stretching and merge over-dense or flat runs, so vertices go where the
+    // outline bends. Returns true if the outline was resampled.
+    // Shrinking stays inside the drop's block. If the new outline needs a
+    // larger block and `needsGrow` is given, nothing is changed and the flag
+    // is set instead, so worker threads never touch the pool allocator; the
+    // caller repeats the call without it on the owning thread.
+    bool remesh(const RemeshParams& params, bool* needsGrow = nullptr);
+    int getVertexCount() const { return n; }
+    uint32_t getPoolOffset() const { return offset; }
+    uint32_t getPoolStride() const { return stride; }
+    // Radius of a disc around the center that lies entirely inside the
+    // outline, or 0 if the center itself falls outside (deeply marbled drop).
+    float inscribedRadius() const;
+    // Even-odd test against the committed outline.
+    bool containsPoint(Vector2 p) const;
+    // Largest distance from p to any vertex of the outline.
+    float farthestVertexFrom(Vector2 p) const;
+    // True if the drop paints fully opaque now and after color blending.
+    bool isOpaque() const { return (clr & 0xFF) == 0xFF && (!hasTarget || (targetClr & 0xFF) == 0xFF); }
+    bool isRetired() const { return retired; }
+    // Release the vertex block and stop taking part in marbling and drawing.
+    void retire();
+    // Undo: become `saved` (a copy of this drop taken earlier) again, with
+    // the committed outline xs/ys. The drop stays in its own pool block,
+    // growing or releasing it as needed, and its revisions move forward.
+    void restore(const Drop& saved, const float* xs, const float* ys);
+    // Called by DropStore when compaction moves this drop's block.
+    void relocate(uint32_t newOffset) { offset = newOffset; }
+    // Called by DropStore when it converts its pool layout: the block moved
+    // and now has the given layout, with only the committed outline filled.
+    void rebase(uint32_t newOffset, bool compactLayout)
+    {
+        offset = newOffset;
+        compact = compactLayout;
+        polarValid = false;
+        ++revision;
+    }
+    bool isCompact() const { return compact; }
+    uint32_t getOpCursor() const { return opCursor; }
+    void setOpCursor(uint32_t cursor) { opCursor = cursor; }
+    Rectangle getBounds() const { return bounds; }
+    Vector2 getCenter() const { return center; }
+    color getColor() const { return UnpackColor(clr); }
+    uint32_t getPackedColor() const { return clr; }
+    // Current (drawn) outline, getVertexCount() entries each.
+    const float* getCurX() const { return curX(); }
+    const float* getCurY() const { return curY(); }
+    // Bumped whenever the current outline or color changes, so renderers can
+    // skip drops they already uploaded.
+    uint32_t getRevision() const { return revision; }
+    // Committed outline, and a counter bumped on every commitBase(). Data
+    // derived from the committed shape (e.g. triangulation) keys off it.
+    const float* getBaseX() const { return baseX(); }
+    const float* getBaseY() const { return baseY(); }
+    uint32_t getBaseRevision() const { return baseRevision; }
+    double getRadius() const { return radius; }
     // Copy current vertices into baseVertices (use after permanent geometry changes)
     void commitBase();
     // Restore vertices from baseVertices (useful for experimenting with temporary deformations)
     void resetToBase();
+    // Deform the current outline from the committed one with every enabled
+    // effect of `animation` in a single pass. No-op for compact drops, whose
+    // current outline is the committed one.
+    void deform(const DropAnimation& animation);
     // Apply simple value-noise based radial perturbation to edge.
     // amplitude: fraction of radius (e.g. 0.1 = 10% variation)
     // frequency: controls number of bumps around circumference
@@ -61,17 +269,33 @@ public:
     void blendColor(const color& target, float t);
     // Animate shape with sinusoidal waves (fluid ripple feel).
     // time: seconds, amplitude: fraction of radius, speed: phase speed, harmonics: number of sine layers.
+    // Both single-effect helpers replace the current outline; use deform()
+    // to combine them.
     void animateShape(float time, float amplitude, float speed, int harmonics = 1);
     // Set transparency (0..255)
-    void setAlpha(int a) { clr.a = a; }
+    void setAlpha(int a)
+    {
+        clr = (clr & ~0xFFu) | (static_cast<uint32_t>(a) & 0xFF);
+        ++revision;
+    }
     // Apply a vertical tine (comb/stylus) deformation at x position. strength controls
     // maximum horizontal displacement (pixels). radius is falloff distance.
     // Positive strength pushes points sideways away from the tine; a subtle vertical
     // ripple is added for fluid feel.
     void applyVerticalTine(float x, float strength, float radius, bool commitBase=true);
+    // Apply consecutive TineSegment ops (see MarbleOp) in one pass: each
+    // vertex is carried through every segment in order, then the summed
+    // displacement gets one smoothing step and the outline is committed.
+    // Segments whose band misses the drop cost a bounds test only.
+    void applyTineSegments(const MarbleOp* ops, size_t count);
+    // Apply a Rake op (see MarbleOp) in one pass over the outline. Each
+    // vertex visits only the tines whose band covers it, so the cost does
+    // not grow with the tine count. The displacement gets one smoothing
+    // step and the outline is committed.
+    void applyRake(const MarbleOp& op);
     // Assign a target color for gradual blending
     void setTargetColor(const color& c, float maxBlendAmount = 0.6f) {
-        targetClr = c; hasTarget = true; startClr = clr; blendAccum = 0.0f; maxBlend = maxBlendAmount; if (maxBlend < 0) maxBlend = 0; if (maxBlend > 1) maxBlend = 1; }
+        targetClr = PackColor(c); hasTarget = true; startClr = clr; blendAccum = 0.0f; maxBlend = maxBlendAmount; if (maxBlend < 0) maxBlend = 0; if (maxBlend > 1) maxBlend = 1; }
     // Per-frame update toward target color using small blend step (e.g. 0.02f)
     void updateColor(float step);
 };
\ No newline at end of file
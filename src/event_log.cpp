@@ -0,0 +1,474 @@
+#include "event_log.h"
+
+#include "frame_budget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+
+namespace
+{
+constexpr char kMagic[7] = {'S', 'U', 'M', 'I', 'L', 'O', 'G'};
+constexpr uint8_t kVersion = 3;
+constexpr size_t kHeaderSize = sizeof(kMagic) + 1 + 4;
+// Logs without resolve points are resolved periodically so long logs keep
+// a short op log.
+constexpr size_t kResolveEveryOps = 1024;
+// Largest coordinate, radius or tine strength a loaded log may hold, far
+// beyond any canvas. Bigger values only come from damaged files, and they
+// overflow outline sizing and the spatial index.
+constexpr float kMaxExtent = 1.0e6f;
+
+// Payload sizes after the type byte and time.
+size_t PayloadSize(uint8_t type)
+{
+    switch (type)
+    {
+    case SceneEvent::Drop:
+        return 4 * 3 + 2 + 4 + 4 + 4; // x y radius, vertices, color, target color, blend
+    case SceneEvent::Tine:
+        return 4 * 3; // x strength sharpness
+    case SceneEvent::Clear:
+    case SceneEvent::Checkpoint:
+    case SceneEvent::Undo:
+    case SceneEvent::Redo:
+    case SceneEvent::Trim:
+        return 0;
+    case SceneEvent::Quality:
+    case SceneEvent::Detail:
+        return 1;
+    case SceneEvent::Viewport:
+        return 2 * 2;
+    case SceneEvent::TineSegment:
+        return 4 * 6; // x y x1 y1 strength sharpness
+    case SceneEvent::Rake:
+        return 4 * 4 + 2 + 4 * 2; // x y angle spacing, tines, strength sharpness
+    case SceneEvent::Resolve:
+        return 2 * 2 + 4; // width height, margin
+    case SceneEvent::Pick:
+        return 4 * 2; // x y
+    case SceneEvent::ResolveRange:
+    case SceneEvent::Remesh:
+        return 4 * 2; // first count
+    default:
+        return SIZE_MAX;
+    }
+}
+
+template <typename T>
+void Put(std::vector<uint8_t>& out, T value)
+{
+    // Every supported target (x86, ARM, wasm) is little-endian.
+    uint8_t raw[sizeof(T)];
+    std::memcpy(raw, &value, sizeof(T));
+    out.insert(out.end(), raw, raw + sizeof(T));
+}
+
+template <typename T>
+T Get(const uint8_t*& in)
+{
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+
+// Decode the record at `in` (its type byte), advancing past it.
+SceneEvent Decode(const uint8_t*& in)
+{
+    SceneEvent event;
+    event.type = static_cast<SceneEvent::Type>(*in++);
+    event.time = Get<float>(in);
+    switch (event.type)
+    {
+    case SceneEvent::Drop:
+        event.x = Get<float>(in);
+        event.y = Get<float>(in);
+        event.radius = Get<float>(in);
+        event.vertices = Get<uint16_t>(in);
+        event.rgba = Get<uint32_t>(in);
+        event.targetRgba = Get<uint32_t>(in);
+        event.targetBlend = Get<float>(in);
+        break;
+    case SceneEvent::Tine:
+        event.x = Get<float>(in);
+        event.strength = Get<float>(in);
+        event.sharpness = Get<float>(in);
+        break;
+    case SceneEvent::Clear:
+    case SceneEvent::Checkpoint:
+    case SceneEvent::Undo:
+    case SceneEvent::Redo:
+    case SceneEvent::Trim:
+        break;
+    case SceneEvent::Quality:
+        event.quality = *in++;
+        break;
+    case SceneEvent::Detail:
+        event.level = *in++;
+        break;
+    case SceneEvent::Viewport:
+        event.width = Get<uint16_t>(in);
+        event.height = Get<uint16_t>(in);
+        break;
+    case SceneEvent::TineSegment:
+        event.x = Get<float>(in);
+        event.y = Get<float>(in);
+        event.x1 = Get<float>(in);
+        event.y1 = Get<float>(in);
+        event.strength = Get<float>(in);
+        event.sharpness = Get<float>(in);
+        break;
+    case SceneEvent::Rake:
+        event.x = Get<float>(in);
+        event.y = Get<float>(in);
+        event.angle = Get<float>(in);
+        event.spacing = Get<float>(in);
+        event.tines = Get<uint16_t>(in);
+        event.strength = Get<float>(in);
+        event.sharpness = Get<float>(in);
+        break;
+    case SceneEvent::Resolve:
+        event.width = Get<uint16_t>(in);
+        event.height = Get<uint16_t>(in);
+        event.margin = Get<float>(in);
+        break;
+    case SceneEvent::Pick:
+        event.x = Get<float>(in);
+        event.y = Get<float>(in);
+        break;
+    case SceneEvent::ResolveRange:
+    case SceneEvent::Remesh:
+        event.first = Get<uint32_t>(in);
+        event.count = Get<uint32_t>(in);
+        break;
+    }
+    return event;
+}
+
+bool Finite(std::initializer_list<float> values)
+{
+    return std::all_of(values.begin(), values.end(), [](float value) { return std::isfinite(value); });
+}
+
+// Within kMaxExtent of zero, which also rules out NaN.
+bool InRange(std::initializer_list<float> values)
+{
+    return std::all_of(values.begin(), values.end(), [](float value) { return fabsf(value) <= kMaxExtent; });
+}
+
+// Whether replaying `event` is safe. The app never records anything else,
+// so a record failing this comes from a damaged or foreign file.
+bool Plausible(const SceneEvent& event)
+{
+    if (!std::isfinite(event.time))
+    {
+        return false;
+    }
+    switch (event.type)
+    {
+    case SceneEvent::Drop:
+        return InRange({event.x, event.y}) && event.radius > 0.0f && event.radius <= kMaxExtent &&
+               event.vertices >= 3 && Finite({event.targetBlend});
+    case SceneEvent::Tine:
+        return InRange({event.x, event.strength}) && Finite({event.sharpness});
+    case SceneEvent::TineSegment:
+        return InRange({event.x, event.y, event.x1, event.y1, event.strength}) && Finite({event.sharpness});
+    case SceneEvent::Rake:
+        return InRange({event.x, event.y, event.spacing, event.strength}) && Finite({event.angle, event.sharpness});
+    case SceneEvent::Resolve:
+        return std::isfinite(event.margin) && event.margin >= 0.0f;
+    case SceneEvent::Pick:
+        return Finite({event.x, event.y});
+    default:
+        return true;
+    }
+}
+} // namespace
+
+void EventLog::Reset(uint32_t sessionSeed)
+{
+    seed = sessionSeed;
+    events = 0;
+    last = 0;
+    bytes.assign(kMagic, kMagic + sizeof(kMagic));
+    bytes.push_back(kVersion);
+    Put<uint32_t>(bytes, seed);
+}
+
+void EventLog::Append(const SceneEvent& event)
+{
+    last = bytes.size();
+    bytes.push_back(event.type);
+    Put<float>(bytes, event.time);
+    switch (event.type)
+    {
+    case SceneEvent::Drop:
+        Put<float>(bytes, event.x);
+        Put<float>(bytes, event.y);
+        Put<float>(bytes, event.radius);
+        Put<uint16_t>(bytes, static_cast<uint16_t>(event.vertices));
+        Put<uint32_t>(bytes, event.rgba);
+        Put<uint32_t>(bytes, event.targetRgba);
+        Put<float>(bytes, event.targetBlend);
+        break;
+    case SceneEvent::Tine:
+        Put<float>(bytes, event.x);
+        Put<float>(bytes, event.strength);
+        Put<float>(bytes, event.sharpness);
+        break;
+    case SceneEvent::Clear:
+    case SceneEvent::Checkpoint:
+    case SceneEvent::Undo:
+    case SceneEvent::Redo:
+    case SceneEvent::Trim:
+        break;
+    case SceneEvent::Quality:
+        bytes.push_back(static_cast<uint8_t>(event.quality));
+        break;
+    case SceneEvent::Detail:
+        bytes.push_back(static_cast<uint8_t>(event.level));
+        break;
+    case SceneEvent::Viewport:
+        Put<uint16_t>(bytes, static_cast<uint16_t>(event.width));
+        Put<uint16_t>(bytes, static_cast<uint16_t>(event.height));
+        break;
+    case SceneEvent::TineSegment:
+        Put<float>(bytes, event.x);
+        Put<float>(bytes, event.y);
+        Put<float>(bytes, event.x1);
+        Put<float>(bytes, event.y1);
+        Put<float>(bytes, event.strength);
+        Put<float>(bytes, event.sharpness);
+        break;
+    case SceneEvent::Rake:
+        Put<float>(bytes, event.x);
+        Put<float>(bytes, event.y);
+        Put<float>(bytes, event.angle);
+        Put<float>(bytes, event.spacing);
+        Put<uint16_t>(bytes, static_cast<uint16_t>(event.tines));
+        Put<float>(bytes, event.strength);
+        Put<float>(bytes, event.sharpness);
+        break;
+    case SceneEvent::Resolve:
+        Put<uint16_t>(bytes, static_cast<uint16_t>(event.width));
+        Put<uint16_t>(bytes, static_cast<uint16_t>(event.height));
+        Put<float>(bytes, event.margin);
+        break;
+    case SceneEvent::Pick:
+        Put<float>(bytes, event.x);
+        Put<float>(bytes, event.y);
+        break;
+    case SceneEvent::ResolveRange:
+    case SceneEvent::Remesh:
+        Put<uint32_t>(bytes, event.first);
+        Put<uint32_t>(bytes, event.count);
+        break;
+    }
+    ++events;
+}
+
+bool EventLog::AppendIfChanged(const SceneEvent& event)
+{
+    const size_t previous = last;
+    const size_t at = bytes.size();
+    Append(event);
+    // Type byte, then the time, which may differ, then the payload.
+    const size_t size = bytes.size() - at;
+    if (previous >= kHeaderSize && at - previous == size && bytes[previous] == bytes[at] &&
+        std::memcmp(bytes.data() + previous + 5, bytes.data() + at + 5, size - 5) == 0)
+    {
+        bytes.resize(at);
+        last = previous;
+        --events;
+        return false;
+    }
+    return true;
+}
+
+bool EventLog::Save(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
+
+bool EventLog::Load(const uint8_t* data, size_t size)
+{
+    if (size < kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0 || data[sizeof(kMagic)] != kVersion)
+    {
+        return false;
+    }
+    // Validate the whole record stream before replacing anything.
+    size_t count = 0;
+    size_t lastRecord = 0;
+    for (size_t at = kHeaderSize; at < size; ++count)
+    {
+        const size_t payload = PayloadSize(data[at]);
+        if (payload == SIZE_MAX || size - at < 1 + 4 + payload)
+        {
+            return false;
+        }
+        const uint8_t* record = data + at;
+        if (!Plausible(Decode(record)))
+        {
+            return false;
+        }
+        lastRecord = at;
+        at += 1 + 4 + payload;
+    }
+    const uint8_t* in = data + sizeof(kMagic) + 1;
+    seed = Get<uint32_t>(in);
+    bytes.assign(data, data + size);
+    events = count;
+    last = lastRecord;
+    return true;
+}
+
+bool EventLog::Load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return Load(data.data(), data.size());
+}
+
+std::vector<SceneEvent> EventLog::Events() const
+{
+    std::vector<SceneEvent> out;
+    out.reserve(events);
+    const uint8_t* in = bytes.data() + kHeaderSize;
+    const uint8_t* end = bytes.data() + bytes.size();
+    while (in < end)
+    {
+        out.push_back(Decode(in));
+    }
+    return out;
+}
+
+ReplayResult ReplayEvents(const std::vector<SceneEvent>& events, MarblingScene& scene, float scale)
+{
+    ReplayResult result;
+    scene.Clear();
+    // Keeping undo copies costs memory and time; only logs that undo need them.
+    const bool undoable = std::any_of(events.begin(), events.end(), [](const SceneEvent& event)
+                                      { return event.type == SceneEvent::Undo; });
+    const bool scheduled = std::any_of(events.begin(), events.end(), [](const SceneEvent& event)
+                                       { return event.type == SceneEvent::Resolve || event.type == SceneEvent::Trim; });
+    std::vector<uint32_t> resolved;
+    // Remesh params follow the quality mode scaled by the detail level, as
+    // in the app.
+    int quality = 1;
+    auto applyDetail = [&]()
+    {
+        const RemeshParams params =
+            ScaleRemeshDetail(RemeshParamsForQuality(quality), FrameBudgetController::DetailForLevel(result.level));
+        if (scheduled)
+        {
+            // The sweep that resamples existing drops was recorded as Remesh
+            // points.
+            scene.SetRemeshParams(params);
+            return;
+        }
+        // Ops recorded so far are resampled under the old setting, then
+        // every drop under the new one, as the app's sweep would.
+        scene.ResolveAll();
+        scene.SetRemeshParams(params);
+        scene.RemeshRange(0, scene.Drops().Size());
+    };
+    for (const SceneEvent& event : events)
+    {
+        switch (event.type)
+        {
+        case SceneEvent::Drop:
+        {
+            Drop& drop = scene.AddDrop(event.x * scale, event.y * scale, UnpackColor(event.rgba), event.radius * scale, event.vertices);
+            if (event.targetBlend >= 0.0f)
+            {
+                drop.setTargetColor(UnpackColor(event.targetRgba), event.targetBlend);
+            }
+            if (!scheduled && scene.PendingOps() >= kResolveEveryOps)
+            {
+                scene.ResolveAll();
+            }
+            break;
+        }
+        case SceneEvent::Tine:
+            scene.AddTine(event.x * scale, event.strength * scale, event.sharpness * scale);
+            break;
+        case SceneEvent::TineSegment:
+        {
+            const Vector2 points[2] = {{event.x * scale, event.y * scale}, {event.x1 * scale, event.y1 * scale}};
+            scene.AddTineStroke(points, 2, event.strength * scale, event.sharpness * scale);
+            break;
+        }
+        case SceneEvent::Rake:
+            scene.AddRake(event.x * scale, event.y * scale, event.angle, event.tines, event.spacing * scale, event.strength * scale,
+                          event.sharpness * scale);
+            break;
+        case SceneEvent::Clear:
+            scene.Clear();
+            break;
+        case SceneEvent::Checkpoint:
+            if (undoable)
+            {
+                scene.Checkpoint();
+            }
+            break;
+        case SceneEvent::Undo:
+            scene.Undo();
+            break;
+        case SceneEvent::Redo:
+            scene.Redo();
+            break;
+        case SceneEvent::Quality:
+            quality = event.quality;
+            result.level = 0;
+            applyDetail();
+            break;
+        case SceneEvent::Detail:
+            result.level = event.level;
+            applyDetail();
+            break;
+        case SceneEvent::Viewport:
+            result.width = static_cast<int>(event.width * scale + 0.5f);
+            result.height = static_cast<int>(event.height * scale + 0.5f);
+            break;
+        case SceneEvent::Resolve:
+            scene.ResolveVisible({0.0f, 0.0f, event.width * scale, event.height * scale}, event.margin, resolved);
+            break;
+        case SceneEvent::Trim:
+            scene.TrimLog();
+            break;
+        case SceneEvent::Pick:
+            scene.PickDrop(event.x * scale, event.y * scale);
+            break;
+        case SceneEvent::ResolveRange:
+        {
+            const size_t end = std::min(scene.Drops().Size(), static_cast<size_t>(event.first) + event.count);
+            resolved.clear();
+            for (size_t i = event.first; i < end; ++i)
+            {
+                if (!scene.Drops()[i].isRetired())
+                {
+                    resolved.push_back(static_cast<uint32_t>(i));
+                }
+            }
+            scene.ResolveDrops(resolved);
+            break;
+        }
+        case SceneEvent::Remesh:
+            scene.RemeshRange(event.first, event.count);
+            break;
+        }
+        ++result.events;
+    }
+    scene.ResolveAll();
+    return result;
+}
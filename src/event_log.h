@@ -0,0 +1,127 @@
+#pragma once
+
+#include "drops.h"
+#include "scene.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compact binary record of every scene mutation in a session, enough to
+// rebuild the scene without the UI. Records carry the resolved values (the
+// colors the random picks produced), so replay needs no RNG; the session
+// seed is stored in the header so a live session can be re-run as well.
+//
+// Layout, little-endian: "SUMILOG" then a version byte, a u32 seed, then
+// records of a u8 type, an f32 time in seconds since the session started
+// and a type-specific payload (see event_log.cpp).
+struct SceneEvent
+{
+    enum Type : uint8_t
+    {
+        Drop = 1,
+        Tine = 2,
+        Clear = 3,
+        Quality = 4,
+        Viewport = 5,
+        TineSegment = 6,
+        Rake = 7,
+        // Start of an undoable action, then undo and redo steps (no payload).
+        Checkpoint = 8,
+        Undo = 9,
+        Redo = 10,
+        // Points where the session resolved drops, replayed as recorded:
+        // remeshing and far-field runs split where resolves happen, so the
+        // rebuilt geometry only matches when they happen at the same ops.
+        // Resolve: ResolveVisible over the width x height viewport with a
+        // deformation margin; Trim: TrimLog; Pick: PickDrop at (x, y);
+        // ResolveRange: drops [first, first + count) resolved regardless of
+        // visibility (for baking, or at the end of a replay); Remesh:
+        // RemeshRange(first, count). Drop indices count evicted drops too,
+        // so they stay valid in a replay, which keeps every drop.
+        Resolve = 11,
+        Trim = 12,
+        Pick = 13,
+        ResolveRange = 14,
+        Remesh = 15,
+        // Frame-budget detail level (see FrameBudgetController); a Quality
+        // event starts again from level 0.
+        Detail = 16
+    };
+    Type type = Drop;
+    float time = 0.0f;
+    // Drop: center, radius and vertex count; tine: x only; tine segment:
+    // start (x, y) and end (x1, y1); rake: comb center (x, y).
+    float x = 0.0f, y = 0.0f, radius = 0.0f;
+    float x1 = 0.0f, y1 = 0.0f;
+    // Rake pull direction in degrees, tine spacing and count.
+    float angle = 0.0f, spacing = 0.0f;
+    int tines = 0;
+    int vertices = 0;
+    uint32_t rgba = 0;
+    // Drop target color and blend amount (negative: no target).
+    uint32_t targetRgba = 0;
+    float targetBlend = -1.0f;
+    float strength = 0.0f, sharpness = 0.0f;
+    // Quality mode and detail level, or viewport width and height.
+    int quality = 0;
+    int level = 0;
+    int width = 0, height = 0;
+    // Resolve deformation margin; ResolveRange and Remesh drop range.
+    float margin = 0.0f;
+    uint32_t first = 0, count = 0;
+};
+
+class EventLog
+{
+public:
+    explicit EventLog(uint32_t seed = 0) { Reset(seed); }
+
+    // Start a new session; drops every recorded event.
+    void Reset(uint32_t seed);
+    void Append(const SceneEvent& event);
+    // Append unless the last record is the same event (time aside). Used
+    // for resolve points, which only need recording when something was
+    // recorded since. Returns true if appended.
+    bool AppendIfChanged(const SceneEvent& event);
+
+    uint32_t Seed() const { return seed; }
+    const std::vector<uint8_t>& Bytes() const { return bytes; }
+    size_t EventCount() const { return events; }
+
+    bool Save(const std::string& path) const;
+    // Replace the contents with a serialized log. False if it is malformed
+    // or holds values the app never records (non-finite numbers, sizes or
+    // coordinates beyond any canvas), leaving the log unchanged.
+    bool Load(const uint8_t* data, size_t size);
+    bool Load(const std::string& path);
+
+    // Decode every event in order.
+    std::vector<SceneEvent> Events() const;
+
+private:
+    std::vector<uint8_t> bytes;
+    uint32_t seed = 0;
+    size_t events = 0;
+    // Offset of the last record in `bytes`, or 0 if there is none.
+    size_t last = 0;
+};
+
+// Rebuild a scene from `events` without drawing or animating. Drops are
+// resolved at the recorded resolve points, then every drop at the end, so
+// at scale 1 the result matches the live session vertex for vertex (drops
+// the session baked keep being marbled as live drops). Logs without
+// resolve points are resolved in bulk every 1024 ops instead.
+// Coordinates, radii and tine parameters are multiplied by `scale` to
+// regenerate the scene at another resolution. Returns the last viewport
+// recorded (scaled), or {0, 0} if there was none.
+struct ReplayResult
+{
+    int width = 0;
+    int height = 0;
+    size_t events = 0;
+    // Detail level the log ended at.
+    int level = 0;
+};
+ReplayResult ReplayEvents(const std::vector<SceneEvent>& events, MarblingScene& scene, float scale = 1.0f);
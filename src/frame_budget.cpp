@@ -0,0 +1,92 @@
+#include "frame_budget.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr float kDetail[FrameBudgetController::kLevelCount] = {1.0f, 0.7f, 0.5f, 0.35f, 0.25f};
+// Decisions are made on windows this long, so a step down lands within a
+// few hundred milliseconds of the load appearing.
+constexpr double kWindowSeconds = 0.25;
+// Over budget: frames noticeably longer than the budget (vsync-paced frames
+// sit at it), or the app's own work eating most of it.
+constexpr float kFrameHighWater = 1.2f;
+constexpr float kWorkHighWater = 0.85f;
+// Two levels at once when frames take this many budgets.
+constexpr float kSevereOverload = 2.0f;
+// Under budget: work this far below the budget for kRaiseDwell seconds.
+constexpr float kWorkLowWater = 0.45f;
+constexpr double kRaiseDwell = 2.0;
+} // namespace
+
+void FrameBudgetController::SetBudget(float ms)
+{
+    budgetMs = std::max(ms, 0.0f);
+    Reset();
+}
+
+void FrameBudgetController::Reset()
+{
+    level = 0;
+    windowStart = -1.0;
+    calmSince = -1.0;
+    workSum = 0.0;
+    frameSum = 0.0;
+    frames = 0;
+}
+
+float FrameBudgetController::DetailForLevel(int level)
+{
+    return kDetail[std::clamp(level, 0, kLevelCount - 1)];
+}
+
+bool FrameBudgetController::AddFrame(double now, float workMs, float frameMs)
+{
+    if (budgetMs <= 0.0f)
+    {
+        return false;
+    }
+    if (windowStart < 0.0)
+    {
+        windowStart = now;
+    }
+    workSum += workMs;
+    frameSum += frameMs;
+    ++frames;
+    if (now - windowStart < kWindowSeconds)
+    {
+        return false;
+    }
+
+    const float work = static_cast<float>(workSum / static_cast<double>(frames));
+    const float frame = static_cast<float>(frameSum / static_cast<double>(frames));
+    windowStart = now;
+    workSum = 0.0;
+    frameSum = 0.0;
+    frames = 0;
+
+    const int previous = level;
+    if (frame > budgetMs * kFrameHighWater || work > budgetMs * kWorkHighWater)
+    {
+        const int steps = std::max(frame, work) > budgetMs * kSevereOverload ? 2 : 1;
+        level = std::min(level + steps, kLevelCount - 1);
+        calmSince = -1.0;
+    }
+    else if (work < budgetMs * kWorkLowWater && frame <= budgetMs * kFrameHighWater)
+    {
+        if (calmSince < 0.0)
+        {
+            calmSince = now;
+        }
+        else if (level > 0 && now - calmSince >= kRaiseDwell)
+        {
+            --level;
+            calmSince = now;
+        }
+    }
+    else
+    {
+        calmSince = -1.0;
+    }
+    return level != previous;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+// Picks a geometry detail level so frames fit a time budget. Frames are
+// averaged over short windows; a window over budget steps detail down at
+// once (two steps when far over), while stepping up needs the scene to stay
+// well under budget for a longer dwell. The gap between the two thresholds
+// and dwells is the hysteresis that keeps the level from oscillating.
+//
+// Level 0 is the full detail of the current QualityMode; higher levels are
+// coarser. The caller maps Detail() onto remesh limits and vertex counts and
+// resamples existing drops when the level changes.
+class FrameBudgetController
+{
+public:
+    static constexpr int kLevelCount = 5;
+
+    // Target frame time in milliseconds; 0 disables the controller, which
+    // then stays at level 0.
+    void SetBudget(float ms);
+    float Budget() const { return budgetMs; }
+    // Back to full detail and a fresh window, e.g. after a quality change.
+    void Reset();
+
+    // Record one frame: `workMs` is the time the app spent producing it,
+    // `frameMs` the whole frame including presentation and pacing. Returns
+    // true if the level changed.
+    bool AddFrame(double now, float workMs, float frameMs);
+
+    int Level() const { return level; }
+    // Fraction of full detail for the current level, in (0, 1].
+    float Detail() const { return DetailForLevel(level); }
+    // The same for any level; out-of-range levels are clamped.
+    static float DetailForLevel(int level);
+
+private:
+    float budgetMs = 1000.0f / 60.0f;
+    int level = 0;
+    double windowStart = -1.0;
+    double calmSince = -1.0;
+    double workSum = 0.0;
+    double frameSum = 0.0;
+    size_t frames = 0;
+};
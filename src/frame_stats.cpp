@@ -0,0 +1,83 @@
+#include "frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+float Milliseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+// Nearest-rank percentile of the first `n` values (reordered in place).
+float Percentile(float* values, size_t n, float p)
+{
+    const size_t rank = std::min(n - 1, static_cast<size_t>(std::ceil(p * static_cast<float>(n))) - 1);
+    std::nth_element(values, values + rank, values + n);
+    return values[rank];
+}
+} // namespace
+
+void FrameStats::BeginFrame()
+{
+    const Clock::time_point now = Clock::now();
+    if (inFrame)
+    {
+        // Close the previous frame: its total runs start to start, so time
+        // spent outside the laps (the browser, the event loop) is included.
+        current.ms[kPhaseCount] = Milliseconds(now - frameStart);
+        ring[head] = current;
+        head = (head + 1) % kHistory;
+        count = std::min(count + 1, kHistory);
+    }
+    current = Frame{};
+    inFrame = true;
+    frameStart = now;
+    lastMark = now;
+}
+
+void FrameStats::Lap(FramePhase phase)
+{
+    const Clock::time_point now = Clock::now();
+    current.ms[static_cast<size_t>(phase)] += Milliseconds(now - lastMark);
+    lastMark = now;
+}
+
+const float* FrameStats::Summary()
+{
+    std::array<float, kHistory> values;
+    for (size_t row = 0; row < kRowCount; ++row)
+    {
+        float* out = summary.data() + row * kColumnCount;
+        if (count == 0)
+        {
+            std::fill(out, out + kColumnCount, 0.0f);
+            continue;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            values[i] = ring[i].ms[row];
+        }
+        out[0] = Percentile(values.data(), count, 0.50f);
+        out[1] = Percentile(values.data(), count, 0.95f);
+        out[2] = Percentile(values.data(), count, 0.99f);
+        out[3] = Sample(row, 0);
+    }
+    return summary.data();
+}
+
+float FrameStats::Sample(size_t row, size_t age) const
+{
+    if (age >= count || row >= kRowCount)
+    {
+        return 0.0f;
+    }
+    return ring[(head + kHistory - 1 - age) % kHistory].ms[row];
+}
+
+const char* FrameStats::PhaseName(size_t row)
+{
+    static const char* const kNames[kRowCount] = {"input", "marble", "deform", "submit", "present", "frame"};
+    return row < kRowCount ? kNames[row] : "";
+}
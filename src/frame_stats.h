@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+// Per-phase frame timings over a ring of recent frames, so jank can be
+// pinned on a phase without a profiler. A frame is timed as a sequence of
+// laps: BeginFrame() starts the clock and each Lap(phase) charges the time
+// since the previous mark to `phase`.
+//
+// Present covers EndDrawing(): the buffer swap and, natively, raylib's
+// SetTargetFPS wait, so it absorbs idle time as well as GPU back-pressure.
+enum class FramePhase
+{
+    Input = 0,   // input handling and op recording
+    Marble = 1,  // resolving pending ops, baking, pixel-engine sync
+    Deform = 2,  // per-frame outline deformation on the CPU
+    Submit = 3,  // geometry upload and draw calls, overlays
+    Present = 4, // EndDrawing: swap and frame pacing
+    Count = 5
+};
+
+class FrameStats
+{
+public:
+    static constexpr size_t kPhaseCount = static_cast<size_t>(FramePhase::Count);
+    // Summary rows: one per phase, then the whole frame (start to start).
+    static constexpr size_t kRowCount = kPhaseCount + 1;
+    // Columns per row: p50, p95, p99 and the latest sample, in milliseconds.
+    static constexpr size_t kColumnCount = 4;
+    static constexpr size_t kHistory = 240;
+
+    void BeginFrame();
+    void Lap(FramePhase phase);
+
+    size_t SampleCount() const { return count; }
+    // Recompute percentiles over the ring; returns kRowCount * kColumnCount
+    // floats, row-major. Cheap enough to call every frame (a few thousand
+    // comparisons).
+    const float* Summary();
+    // Milliseconds of `phase` (or the whole frame for kPhaseCount) `age`
+    // frames ago, 0 being the last completed frame.
+    float Sample(size_t row, size_t age) const;
+
+    static const char* PhaseName(size_t row);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame
+    {
+        std::array<float, kRowCount> ms{};
+    };
+
+    std::array<Frame, kHistory> ring{};
+    size_t head = 0;
+    size_t count = 0;
+    Frame current;
+    bool inFrame = false;
+    Clock::time_point frameStart;
+    Clock::time_point lastMark;
+    std::array<float, kRowCount * kColumnCount> summary{};
+};
@@ -0,0 +1,160 @@
+#include "job_system.h"
+
+#include <algorithm>
+
+namespace
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+constexpr bool kThreadsAvailable = false;
+#else
+constexpr bool kThreadsAvailable = true;
+#endif
+constexpr unsigned kMaxWorkers = 63;
+
+// Queue index of the current thread inside its pool; workers set it once.
+thread_local const JobSystem* tlsPool = nullptr;
+thread_local size_t tlsQueue = 0;
+} // namespace
+
+JobSystem::JobSystem(unsigned workerCount)
+{
+    if (!kThreadsAvailable)
+    {
+        workerCount = 0;
+    }
+    workerCount = std::min(workerCount, kMaxWorkers);
+    for (unsigned i = 0; i <= workerCount; ++i)
+    {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back([this, i]
+                             { WorkerLoop(i); });
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+JobSystem& JobSystem::Instance()
+{
+    const unsigned hardware = std::thread::hardware_concurrency();
+    static JobSystem pool(hardware > 1 ? hardware - 1 : 0);
+    return pool;
+}
+
+size_t JobSystem::CallerQueue() const
+{
+    return tlsPool == this ? tlsQueue : queues.size() - 1;
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const RangeFn& body)
+{
+    grain = std::max<size_t>(grain, 1);
+    if (count == 0)
+    {
+        return;
+    }
+    if (workers.empty() || count <= grain)
+    {
+        body(0, count);
+        return;
+    }
+
+    Batch batch;
+    batch.body = &body;
+    const size_t chunks = (count + grain - 1) / grain;
+    batch.remaining.store(chunks, std::memory_order_relaxed);
+
+    // Deal chunks round-robin so every thread starts with local work; the
+    // caller's own queue gets the first chunk.
+    const size_t self = CallerQueue();
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        Queue& queue = *queues[(self + c) % queues.size()];
+        const size_t begin = c * grain;
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back({&batch, begin, std::min(begin + grain, count)});
+    }
+    queued.fetch_add(chunks, std::memory_order_release);
+    {
+        // Taking the lock orders the push with sleeping workers' predicate check.
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_all();
+
+    while (batch.remaining.load(std::memory_order_acquire) != 0)
+    {
+        if (!TryRunOne(self))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::TryRunOne(size_t self)
+{
+    Task task;
+    bool found = false;
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+    for (size_t step = 1; !found && step < queues.size(); ++step)
+    {
+        Queue& victim = *queues[(self + step) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        return false;
+    }
+
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    (*task.batch->body)(task.begin, task.end);
+    task.batch->remaining.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void JobSystem::WorkerLoop(size_t self)
+{
+    tlsPool = this;
+    tlsQueue = self;
+    for (;;)
+    {
+        if (TryRunOne(self))
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]
+                  { return stopping || queued.load(std::memory_order_acquire) != 0; });
+        if (stopping)
+        {
+            return;
+        }
+    }
+}
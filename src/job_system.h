@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small work-stealing thread pool for per-drop work. Every thread owns a
+// task deque: it pops its own newest task and, when that runs dry, steals
+// the oldest task of another thread. A thread waiting for a ParallelFor to
+// finish keeps running tasks too, so nested calls cannot deadlock.
+//
+// ParallelFor only decides which thread runs an index, never what it
+// computes, so results are bit-identical to the serial loop as long as the
+// body touches nothing but its own indices.
+//
+// Single-threaded WebAssembly builds (no pthreads) get a pool without
+// workers and every call runs inline on the caller.
+class JobSystem
+{
+public:
+    using RangeFn = std::function<void(size_t begin, size_t end)>;
+
+    explicit JobSystem(unsigned workerCount);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Shared pool sized to the machine (one worker per extra hardware thread).
+    static JobSystem& Instance();
+
+    // Run body over [0, count) in chunks of at most `grain` indices and
+    // return once every chunk has finished.
+    void ParallelFor(size_t count, size_t grain, const RangeFn& body);
+
+    unsigned ThreadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+private:
+    struct Batch
+    {
+        const RangeFn* body = nullptr;
+        std::atomic<size_t> remaining{0};
+    };
+    struct Task
+    {
+        Batch* batch = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool TryRunOne(size_t self);
+    void WorkerLoop(size_t self);
+    size_t CallerQueue() const;
+
+    // One queue per worker plus a shared one for threads outside the pool.
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued{0};
+    bool stopping = false;
+};
@@ -1,5 +1,7 @@
 #include "app.h"
 
+#include <cstring>
+
 #ifdef __EMSCRIPTEN__
 #include <emscripten/emscripten.h>
 
@@ -9,12 +11,42 @@ static void MainLoop(void* arg)
 }
 #endif
 
-int main(void)
+int main(int argc, char** argv)
 {
     SuminagashiApp& app = GetApp();
     app.Initialize();
+    // suminasashi [--replay <file.sumilog>] [--record <file.sumilog>] [--stats]
+    //             [--compact]
+    // restores a recorded session and/or saves this one on exit; --stats
+    // shows the per-phase frame timing overlay and --compact switches to the
+    // compact geometry storage.
+    const char* recordPath = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--stats") == 0)
+        {
+            app.SetFrameStatsOverlay(true);
+        }
+        else if (std::strcmp(argv[i], "--compact") == 0)
+        {
+            app.SetCompactStorage(true);
+        }
+        else if (i + 1 >= argc)
+        {
+            break;
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0)
+        {
+            app.ReplayEventLog(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--record") == 0)
+        {
+            recordPath = argv[++i];
+        }
+    }
 
 #ifdef __EMSCRIPTEN__
+    (void)recordPath; // the page saves through getEventLogData() instead
     emscripten_set_main_loop_arg(MainLoop, &app, 0, 1);
     return 0;
 #else
@@ -23,6 +55,10 @@ int main(void)
         app.DrawFrame();
     }
 
+    if (recordPath)
+    {
+        app.SaveEventLog(recordPath);
+    }
     app.Shutdown();
     return 0;
 #endif
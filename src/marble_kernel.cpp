@@ -0,0 +1,314 @@
+#include "marble_kernel.h"
+
+#include <cmath>
+
+#if !defined(SUMINAGASHI_NO_SIMD)
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SUMINAGASHI_MARBLE_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SUMINAGASHI_MARBLE_SSE2 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define SUMINAGASHI_MARBLE_WASM 1
+#endif
+#endif
+
+namespace
+{
+constexpr float kEps = 1e-6f;      // avoid divide-by-zero
+constexpr float kMaxScale = 6.0f;  // tighter safety cap against extreme stretching
+constexpr float kJitterScale = 0.0005f;
+// Sources whose per-lane constants are kept resident while a vertex block is
+// in registers; longer bursts are processed in chunks of this size.
+constexpr size_t kSourceChunk = 32;
+
+// Single vertex version shared by the scalar kernel and the SIMD tails so the
+// leftover lanes produce exactly what the reference loop would.
+inline void MarbleOne(float& x, float& y, float cx, float cy, float r)
+{
+    const float dx = x - cx;
+    const float dy = y - cy;
+    const float m2 = dx * dx + dy * dy;
+    if (m2 < kEps)
+    {
+        // Vertex sits (almost) on the other drop's center; push it outward
+        // along the current (stable) direction by radius r.
+        const float push = r / sqrtf(kEps);
+        x = cx + dx * push;
+        y = cy + dy * push;
+        return;
+    }
+    const float m = sqrtf(m2);
+    const float invM = 1.0f / m;
+    // Rational smoothing: newDist = m + r^2 / (m + r).
+    const float k = (r * r) / (m + r);
+    float scale = (m + k) * invM;
+    if (scale > kMaxScale)
+        scale = kMaxScale;
+    const float jitter = kJitterScale * r * invM; // perpendicular nudge, normalized
+    x = cx + dx * scale - dy * jitter;
+    y = cy + dy * scale + dx * jitter;
+}
+
+#if defined(SUMINAGASHI_MARBLE_AVX)
+struct SimdOps
+{
+    using V = __m256;
+    static constexpr size_t kWidth = 8;
+    static const char* Name() { return "avx"; }
+    static V Set(float v) { return _mm256_set1_ps(v); }
+    static V Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V Div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V Sqrt(V a) { return _mm256_sqrt_ps(a); }
+    static V Min(V a, V b) { return _mm256_min_ps(a, b); }
+    static V Max(V a, V b) { return _mm256_max_ps(a, b); }
+    static V Less(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    // Lanes where mask is set take `a`, the others take `b`.
+    static V Select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+};
+#elif defined(SUMINAGASHI_MARBLE_SSE2)
+struct SimdOps
+{
+    using V = __m128;
+    static constexpr size_t kWidth = 4;
+    static const char* Name() { return "sse2"; }
+    static V Set(float v) { return _mm_set1_ps(v); }
+    static V Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, V v) { _mm_storeu_ps(p, v); }
+    static V Add(V a, V b) { return _mm_add_ps(a, b); }
+    static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V Div(V a, V b) { return _mm_div_ps(a, b); }
+    static V Sqrt(V a) { return _mm_sqrt_ps(a); }
+    static V Min(V a, V b) { return _mm_min_ps(a, b); }
+    static V Max(V a, V b) { return _mm_max_ps(a, b); }
+    static V Less(V a, V b) { return _mm_cmplt_ps(a, b); }
+    // SSE2 has no blendv; select with and/andnot/or.
+    static V Select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+};
+#elif defined(SUMINAGASHI_MARBLE_WASM)
+struct SimdOps
+{
+    using V = v128_t;
+    static constexpr size_t kWidth = 4;
+    static const char* Name() { return "wasm-simd128"; }
+    static V Set(float v) { return wasm_f32x4_splat(v); }
+    static V Load(const float* p) { return wasm_v128_load(p); }
+    static void Store(float* p, V v) { wasm_v128_store(p, v); }
+    static V Add(V a, V b) { return wasm_f32x4_add(a, b); }
+    static V Sub(V a, V b) { return wasm_f32x4_sub(a, b); }
+    static V Mul(V a, V b) { return wasm_f32x4_mul(a, b); }
+    static V Div(V a, V b) { return wasm_f32x4_div(a, b); }
+    static V Sqrt(V a) { return wasm_f32x4_sqrt(a); }
+    static V Min(V a, V b) { return wasm_f32x4_min(a, b); }
+    static V Max(V a, V b) { return wasm_f32x4_max(a, b); }
+    static V Less(V a, V b) { return wasm_f32x4_lt(a, b); }
+    static V Select(V mask, V a, V b) { return wasm_v128_bitselect(a, b, mask); }
+};
+#endif
+
+#if defined(SUMINAGASHI_MARBLE_AVX) || defined(SUMINAGASHI_MARBLE_SSE2) || defined(SUMINAGASHI_MARBLE_WASM)
+#define SUMINAGASHI_MARBLE_HAS_SIMD 1
+
+// Per-source constants broadcast once per call instead of once per block.
+struct SimdSource
+{
+    SimdOps::V cx, cy, r, r2, jitter, push;
+};
+
+template <class Ops>
+inline void MarbleBlock(typename Ops::V& x, typename Ops::V& y, const SimdSource& s)
+{
+    using V = typename Ops::V;
+    const V eps = Ops::Set(kEps);
+    const V dx = Ops::Sub(x, s.cx);
+    const V dy = Ops::Sub(y, s.cy);
+    const V m2 = Ops::Add(Ops::Mul(dx, dx), Ops::Mul(dy, dy));
+    const V degenerate = Ops::Less(m2, eps);
+    // Clamp m2 so degenerate lanes do not produce Inf/NaN before being replaced.
+    const V m = Ops::Sqrt(Ops::Max(m2, eps));
+    const V invM = Ops::Div(Ops::Set(1.0f), m);
+    const V k = Ops::Div(s.r2, Ops::Add(m, s.r));
+    const V scale = Ops::Min(Ops::Mul(Ops::Add(m, k), invM), Ops::Set(kMaxScale));
+    const V jitter = Ops::Mul(s.jitter, invM);
+    const V nx = Ops::Sub(Ops::Add(s.cx, Ops::Mul(dx, scale)), Ops::Mul(dy, jitter));
+    const V ny = Ops::Add(Ops::Add(s.cy, Ops::Mul(dy, scale)), Ops::Mul(dx, jitter));
+    const V px = Ops::Add(s.cx, Ops::Mul(dx, s.push));
+    const V py = Ops::Add(s.cy, Ops::Mul(dy, s.push));
+    x = Ops::Select(degenerate, px, nx);
+    y = Ops::Select(degenerate, py, ny);
+}
+
+template <class Ops>
+void MarbleFused(float* xs, float* ys, size_t count, const MarbleSource* sources, size_t sourceCount)
+{
+    SimdSource lanes[kSourceChunk];
+    for (size_t first = 0; first < sourceCount; first += kSourceChunk)
+    {
+        const size_t chunk = sourceCount - first < kSourceChunk ? sourceCount - first : kSourceChunk;
+        for (size_t s = 0; s < chunk; ++s)
+        {
+            const MarbleSource& src = sources[first + s];
+            lanes[s] = {Ops::Set(src.cx), Ops::Set(src.cy), Ops::Set(src.r), Ops::Set(src.r * src.r),
+                        Ops::Set(kJitterScale * src.r), Ops::Set(src.r / sqrtf(kEps))};
+        }
+        size_t i = 0;
+        for (; i + Ops::kWidth <= count; i += Ops::kWidth)
+        {
+            typename Ops::V x = Ops::Load(xs + i);
+            typename Ops::V y = Ops::Load(ys + i);
+            for (size_t s = 0; s < chunk; ++s)
+            {
+                MarbleBlock<Ops>(x, y, lanes[s]);
+            }
+            Ops::Store(xs + i, x);
+            Ops::Store(ys + i, y);
+        }
+        MarbleVerticesFusedScalar(xs + i, ys + i, count - i, sources + first, chunk);
+    }
+}
+#endif
+} // namespace
+
+void MarbleVerticesScalar(float* xs, float* ys, size_t count, float cx, float cy, float r)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        MarbleOne(xs[i], ys[i], cx, cy, r);
+    }
+}
+
+void MarbleVerticesFusedScalar(float* xs, float* ys, size_t count, const MarbleSource* sources, size_t sourceCount)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        float x = xs[i];
+        float y = ys[i];
+        for (size_t s = 0; s < sourceCount; ++s)
+        {
+            MarbleOne(x, y, sources[s].cx, sources[s].cy, sources[s].r);
+        }
+        xs[i] = x;
+        ys[i] = y;
+    }
+}
+
+void MarbleVerticesSimd(float* xs, float* ys, size_t count, float cx, float cy, float r)
+{
+    const MarbleSource source{cx, cy, r};
+    MarbleVerticesFusedSimd(xs, ys, count, &source, 1);
+}
+
+void MarbleVerticesFusedSimd(float* xs, float* ys, size_t count, const MarbleSource* sources, size_t sourceCount)
+{
+#if defined(SUMINAGASHI_MARBLE_HAS_SIMD)
+    MarbleFused<SimdOps>(xs, ys, count, sources, sourceCount);
+#else
+    MarbleVerticesFusedScalar(xs, ys, count, sources, sourceCount);
+#endif
+}
+
+bool MarbleLinearize(const MarbleSource& source, float minX, float minY, float maxX, float maxY, MarbleLinearization& out)
+{
+    const double r = source.r;
+    // Closest point of the box to the center.
+    const double nx = std::fmin(std::fmax(static_cast<double>(source.cx), minX), maxX) - source.cx;
+    const double ny = std::fmin(std::fmax(static_cast<double>(source.cy), minY), maxY) - source.cy;
+    const double nearest = std::sqrt(nx * nx + ny * ny);
+    if (nearest < r || nearest <= 0.0)
+    {
+        return false;
+    }
+
+    const double px = 0.5 * (static_cast<double>(minX) + maxX);
+    const double py = 0.5 * (static_cast<double>(minY) + maxY);
+    const double halfW = 0.5 * (static_cast<double>(maxX) - minX);
+    const double halfH = 0.5 * (static_cast<double>(maxY) - minY);
+    const double s2 = halfW * halfW + halfH * halfH;
+    const double jitter = kJitterScale * r;
+    out.error = static_cast<float>(s2 * (6.0 * r * r / (nearest * nearest * nearest) + 1.5 * jitter / (nearest * nearest)));
+    // |DF| <= 1 + h + m |h'| + 2 * jitter / m with h = r^2 / (m (m + r)).
+    out.lipschitz = static_cast<float>(1.0 + 3.0 * r * r / (nearest * nearest) + 2.0 * jitter / nearest);
+
+    // Exact map at the box center and its Jacobian there:
+    //   F(p) = p + v h(m) + jitter * R e,  v = p - c, e = v / m, R = rotation by 90 degrees
+    //   DF = I + h I + m h' e e^T + jitter / m * R (I - e e^T)
+    const double vx = px - source.cx;
+    const double vy = py - source.cy;
+    const double m = std::sqrt(vx * vx + vy * vy);
+    const double ex = vx / m;
+    const double ey = vy / m;
+    const double h = r * r / (m * (m + r));
+    const double mh1 = -r * r * (2.0 * m + r) / (m * (m + r) * (m + r)); // m * h'(m)
+    const double j = jitter / m;
+    // R (I - e e^T) = [[ex ey, -(1 - ey^2)], [1 - ex^2, -ex ey]].
+    const double a = 1.0 + h + mh1 * ex * ex + j * ex * ey;
+    const double b = mh1 * ex * ey - j * (1.0 - ey * ey);
+    const double c = mh1 * ex * ey + j * (1.0 - ex * ex);
+    const double d = 1.0 + h + mh1 * ey * ey - j * ex * ey;
+    const double fx = px + vx * h - jitter * ey;
+    const double fy = py + vy * h + jitter * ex;
+    out.map.a = static_cast<float>(a);
+    out.map.b = static_cast<float>(b);
+    out.map.c = static_cast<float>(c);
+    out.map.d = static_cast<float>(d);
+    out.map.tx = static_cast<float>(fx - (a * px + b * py));
+    out.map.ty = static_cast<float>(fy - (c * px + d * py));
+    return true;
+}
+
+MarbleAffine ComposeAffine(const MarbleAffine& outer, const MarbleAffine& inner)
+{
+    MarbleAffine out;
+    out.a = outer.a * inner.a + outer.b * inner.c;
+    out.b = outer.a * inner.b + outer.b * inner.d;
+    out.c = outer.c * inner.a + outer.d * inner.c;
+    out.d = outer.c * inner.b + outer.d * inner.d;
+    out.tx = outer.a * inner.tx + outer.b * inner.ty + outer.tx;
+    out.ty = outer.c * inner.tx + outer.d * inner.ty + outer.ty;
+    return out;
+}
+
+void TransformVertices(float* xs, float* ys, size_t count, const MarbleAffine& map, float bounds[4])
+{
+    if (count == 0)
+    {
+        return;
+    }
+    // Plain loop with ternary min/max (unlike fminf these need no NaN
+    // handling), so compilers vectorize it on every target.
+    float minX = map.a * xs[0] + map.b * ys[0] + map.tx;
+    float minY = map.c * xs[0] + map.d * ys[0] + map.ty;
+    float maxX = minX;
+    float maxY = minY;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float x = map.a * xs[i] + map.b * ys[i] + map.tx;
+        const float y = map.c * xs[i] + map.d * ys[i] + map.ty;
+        xs[i] = x;
+        ys[i] = y;
+        minX = x < minX ? x : minX;
+        maxX = x > maxX ? x : maxX;
+        minY = y < minY ? y : minY;
+        maxY = y > maxY ? y : maxY;
+    }
+    bounds[0] = minX;
+    bounds[1] = minY;
+    bounds[2] = maxX;
+    bounds[3] = maxY;
+}
+
+const char* MarbleKernelIsa()
+{
+#if defined(SUMINAGASHI_MARBLE_HAS_SIMD)
+    return SimdOps::Name();
+#else
+    return "scalar";
+#endif
+}
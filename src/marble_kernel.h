@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+
+// Marble displacement applied to a structure-of-arrays vertex stream.
+//
+// Every vertex p is pushed radially away from the new drop's center c:
+//   m = |p - c|, p' = c + (p - c) * min(1 + r^2 / (m * (m + r)), MAX_SCALE)
+// plus a tiny perpendicular nudge of 0.0005 * r that keeps neighbouring
+// vertices from collapsing onto each other. The perpendicular direction is
+// taken from (-dy, dx) / m instead of cos/sin(atan2 + pi/2), so no kernel
+// performs a transcendental call per vertex.
+
+// One drop insertion as seen by the kernels.
+struct MarbleSource
+{
+    float cx, cy, r;
+};
+
+// Upper bound on how far a single source can move any vertex.
+inline float MarbleDisplacementBound(float r) { return r * 1.0005f + 1e-3f; }
+
+// Reference implementation, one vertex at a time.
+void MarbleVerticesScalar(float* xs, float* ys, size_t count, float cx, float cy, float r);
+
+// Vectorized implementation (AVX, SSE2 or wasm SIMD128 depending on the
+// target). Falls back to the scalar loop when no SIMD ISA is available.
+void MarbleVerticesSimd(float* xs, float* ys, size_t count, float cx, float cy, float r);
+
+// Apply several sources in order while each vertex block stays in registers,
+// so a burst of k insertions streams the vertices through memory once
+// instead of k times. Results match applying the sources one by one.
+void MarbleVerticesFusedScalar(float* xs, float* ys, size_t count, const MarbleSource* sources, size_t sourceCount);
+void MarbleVerticesFusedSimd(float* xs, float* ys, size_t count, const MarbleSource* sources, size_t sourceCount);
+
+// Affine map x' = a x + b y + tx, y' = c x + d y + ty.
+struct MarbleAffine
+{
+    float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+    float tx = 0.0f, ty = 0.0f;
+};
+
+// Far field. Away from its center a source moves points almost rigidly (the
+// displacement r^2 / (m + r) changes slowly with m), so over a distant box
+// it can be replaced by its linearization about the box center. With s the
+// box half-diagonal and m the closest the box comes to the center, the
+// second derivatives of the map are bounded by 12 r^2 / m^3 (radial part)
+// plus 3 * 0.0005 r / m^2 (nudge), so the linearization errs by at most
+//   s^2 * (6 r^2 / m^3 + 0.00075 r / m^2)
+// anywhere in the box. The bound needs m >= r, which also keeps the scale
+// clamp out of play.
+struct MarbleLinearization
+{
+    MarbleAffine map;
+    float error = 0.0f;     // max distance between exact and linear map over the box (px)
+    float lipschitz = 1.0f; // bound on how much the exact map stretches distances in the box
+};
+
+// Linearize `source` over the box [minX, maxX] x [minY, maxY]. Returns false
+// if the box comes within r of the source center.
+bool MarbleLinearize(const MarbleSource& source, float minX, float minY, float maxX, float maxY, MarbleLinearization& out);
+
+// outer(inner(p)).
+MarbleAffine ComposeAffine(const MarbleAffine& outer, const MarbleAffine& inner);
+
+// Apply `map` in place and return the bounds of the result as min x, min y,
+// max x, max y (left untouched when count is 0).
+void TransformVertices(float* xs, float* ys, size_t count, const MarbleAffine& map, float bounds[4]);
+
+// Name of the instruction set the SIMD kernel was compiled for.
+const char* MarbleKernelIsa();
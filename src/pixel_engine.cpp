@@ -0,0 +1,293 @@
+#include "pixel_engine.h"
+
+#include "rlgl.h"
+#include "warp_shader.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace
+{
+// Ops walked per pixel. Once more are pending, all but kKeptOps of them are
+// flattened into the snapshot, so the snapshot is resampled once per
+// (kMaxWindowOps - kKeptOps) ops instead of every frame.
+constexpr size_t kMaxWindowOps = 256;
+constexpr size_t kKeptOps = 128;
+// Two RGBA32F texels per op, as packed by PackWarpOp.
+constexpr int kTexelsPerOp = kWarpFloatsPerOp / 4;
+constexpr int kOpTextureWidth = 256;
+constexpr int kOpTextureHeight = static_cast<int>(kMaxWindowOps) * kTexelsPerOp / kOpTextureWidth;
+
+// Runs on a full-target quad drawn with raylib's default vertex shader;
+// texture0 is the canvas before the first op. A pixel inside a drop's disc
+// at insertion time is that drop's (over clean background, since the drop
+// pushed all older ink out); otherwise it is pulled back through the op.
+constexpr const char* kShadeInputs = R"(
+IN vec2 fragTexCoord;
+IN vec4 fragColor;
+uniform sampler2D texture0;
+uniform sampler2D ops;
+uniform vec2 opsSize;
+uniform int opCount;
+uniform vec2 size;
+uniform vec4 background;
+
+vec4 fetchOp(int texel)
+{
+    float t = float(texel);
+    float row = floor(t / opsSize.x);
+    return TEXTURE(ops, (vec2(t - row * opsSize.x, row) + 0.5) / opsSize);
+}
+)";
+
+constexpr const char* kShadeMain = R"(
+void main()
+{
+    // Render textures are stored bottom-up; p is in canvas pixels.
+    vec2 p = vec2(fragTexCoord.x, 1.0 - fragTexCoord.y) * size;
+    for (int j = 0; j < MAX_OPS; ++j)
+    {
+        if (j >= opCount)
+            break;
+        int i = opCount - 1 - j;
+        vec4 o = fetchOp(2 * i);
+        // A drop's second texel is only needed for a pixel it covers.
+        vec4 e = o.x > 0.5 ? fetchOp(2 * i + 1) : vec4(0.0);
+        if (!unwarp(p, o, e))
+        {
+            vec4 c = fetchOp(2 * i + 1);
+            finalColor = vec4(mix(background.rgb, c.rgb, c.a), 1.0);
+            return;
+        }
+    }
+    vec2 uv = p / size;
+    if (uv.x < 0.0 || uv.y < 0.0 || uv.x > 1.0 || uv.y > 1.0)
+    {
+        finalColor = background;
+        return;
+    }
+    finalColor = vec4(TEXTURE(texture0, vec2(uv.x, 1.0 - uv.y)).rgb, 1.0);
+}
+)";
+
+Rectangle Flipped(const RenderTexture2D& target)
+{
+    return {0.0f, 0.0f, static_cast<float>(target.texture.width), -static_cast<float>(target.texture.height)};
+}
+} // namespace
+
+bool PixelEngine::IsAvailable()
+{
+    return EnsureGpu();
+}
+
+bool PixelEngine::EnsureGpu()
+{
+    if (shader.id != 0 || gpuFailed)
+    {
+        return shader.id != 0;
+    }
+    // A float texture is refused (id 0) where the GL lacks float support.
+    texels.assign(static_cast<size_t>(kOpTextureWidth) * kOpTextureHeight * 4, 0.0f);
+    opTexture.id = rlLoadTexture(texels.data(), kOpTextureWidth, kOpTextureHeight, RL_PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, 1);
+    opTexture.width = kOpTextureWidth;
+    opTexture.height = kOpTextureHeight;
+    opTexture.mipmaps = 1;
+    opTexture.format = RL_PIXELFORMAT_UNCOMPRESSED_R32G32B32A32;
+
+    const std::string fragment = std::string(kWarpShaderHeader) + "#define MAX_OPS " + std::to_string(kMaxWindowOps) + "\n" + kShadeInputs +
+                                 kWarpShaderInverse + kShadeMain;
+    if (opTexture.id != 0)
+    {
+        shader = LoadShaderFromMemory(nullptr, fragment.c_str());
+    }
+    if (opTexture.id == 0 || !IsShaderReady(shader) || shader.id == rlGetShaderIdDefault())
+    {
+        std::cout << "[pixel] engine unavailable (float textures or shader), staying on vertices" << std::endl;
+        if (opTexture.id != 0)
+        {
+            rlUnloadTexture(opTexture.id);
+        }
+        opTexture = Texture2D{};
+        shader = Shader{};
+        gpuFailed = true;
+        return false;
+    }
+    opsLoc = GetShaderLocation(shader, "ops");
+    opsSizeLoc = GetShaderLocation(shader, "opsSize");
+    opCountLoc = GetShaderLocation(shader, "opCount");
+    sizeLoc = GetShaderLocation(shader, "size");
+    backgroundLoc = GetShaderLocation(shader, "background");
+    std::cout << "[pixel] per-pixel engine ready, " << kMaxWindowOps << " ops per walk" << std::endl;
+    return true;
+}
+
+bool PixelEngine::EnsureTargets(int width, int height)
+{
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if (snapshot.id != 0 && snapshot.texture.width == width && snapshot.texture.height == height)
+    {
+        return true;
+    }
+    RenderTexture2D next = LoadRenderTexture(width, height);
+    RenderTexture2D nextScratch = LoadRenderTexture(width, height);
+    if (next.id == 0 || nextScratch.id == 0)
+    {
+        std::cout << "[pixel] render target " << width << "x" << height << " unavailable" << std::endl;
+        UnloadRenderTexture(next);
+        UnloadRenderTexture(nextScratch);
+        return false;
+    }
+    // Keep the snapshot at its pixel position; a grown area starts empty.
+    BeginTextureMode(next);
+    ClearBackground(kWarpBackground);
+    if (snapshot.id != 0)
+    {
+        DrawTextureRec(snapshot.texture, Flipped(snapshot), {0.0f, 0.0f}, WHITE);
+    }
+    EndTextureMode();
+    UnloadTargets();
+    snapshot = next;
+    scratch = nextScratch;
+    return true;
+}
+
+bool PixelEngine::BeginCapture(MarblingScene& scene, int width, int height)
+{
+    Reset(scene);
+    if (!EnsureGpu() || !EnsureTargets(width, height))
+    {
+        return false;
+    }
+    BeginTextureMode(snapshot);
+    ClearBackground(kWarpBackground);
+    return true;
+}
+
+void PixelEngine::EndCapture(MarblingScene& scene)
+{
+    EndTextureMode();
+    cursor = scene.LogHead();
+    scene.PinLog(this, cursor);
+    active = true;
+}
+
+void PixelEngine::Sync(MarblingScene& scene, int width, int height)
+{
+    if (!active)
+    {
+        return;
+    }
+    EnsureTargets(width, height);
+    size_t count = 0;
+    const MarbleOp* ops = scene.OpsSince(cursor, count);
+    if (count > 0)
+    {
+        window.insert(window.end(), ops, ops + count);
+        opsDirty = true;
+    }
+    cursor = scene.LogHead();
+    scene.PinLog(this, cursor);
+
+    while (window.size() > kMaxWindowOps)
+    {
+        Flatten(std::min(window.size() - kKeptOps, kMaxWindowOps));
+    }
+}
+
+void PixelEngine::UploadOps(size_t count)
+{
+    std::fill(texels.begin(), texels.end(), 0.0f);
+    for (size_t k = 0; k < count; ++k)
+    {
+        PackWarpOp(window[k], texels.data() + k * kWarpFloatsPerOp);
+    }
+    rlUpdateTexture(opTexture.id, 0, 0, kOpTextureWidth, kOpTextureHeight, RL_PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, texels.data());
+}
+
+void PixelEngine::Shade(const RenderTexture2D& source, size_t count)
+{
+    const float opsSize[2] = {static_cast<float>(kOpTextureWidth), static_cast<float>(kOpTextureHeight)};
+    const float size[2] = {static_cast<float>(source.texture.width), static_cast<float>(source.texture.height)};
+    const float background[4] = {kWarpBackground.r / 255.0f, kWarpBackground.g / 255.0f, kWarpBackground.b / 255.0f, 1.0f};
+    const int opCount = static_cast<int>(count);
+    // Every pixel is written opaque; blending would mix in what was there.
+    rlDrawRenderBatchActive();
+    rlDisableColorBlend();
+    BeginShaderMode(shader);
+    SetShaderValueTexture(shader, opsLoc, opTexture);
+    SetShaderValue(shader, opsSizeLoc, opsSize, SHADER_UNIFORM_VEC2);
+    SetShaderValue(shader, opCountLoc, &opCount, SHADER_UNIFORM_INT);
+    SetShaderValue(shader, sizeLoc, size, SHADER_UNIFORM_VEC2);
+    SetShaderValue(shader, backgroundLoc, background, SHADER_UNIFORM_VEC4);
+    DrawTextureRec(source.texture, Flipped(source), {0.0f, 0.0f}, WHITE);
+    EndShaderMode();
+    rlEnableColorBlend();
+}
+
+void PixelEngine::Flatten(size_t count)
+{
+    UploadOps(count);
+    BeginTextureMode(scratch);
+    Shade(snapshot, count);
+    EndTextureMode();
+    std::swap(snapshot, scratch);
+    window.erase(window.begin(), window.begin() + static_cast<std::ptrdiff_t>(count));
+    opsDirty = true;
+}
+
+void PixelEngine::Draw()
+{
+    if (!active)
+    {
+        return;
+    }
+    if (opsDirty)
+    {
+        UploadOps(window.size());
+        opsDirty = false;
+    }
+    Shade(snapshot, window.size());
+}
+
+void PixelEngine::Reset(MarblingScene& scene)
+{
+    scene.UnpinLog(this);
+    UnloadTargets();
+    window.clear();
+    active = false;
+    opsDirty = true;
+}
+
+void PixelEngine::Unload()
+{
+    UnloadTargets();
+    if (shader.id != 0)
+    {
+        UnloadShader(shader);
+    }
+    if (opTexture.id != 0)
+    {
+        rlUnloadTexture(opTexture.id);
+    }
+    shader = Shader{};
+    opTexture = Texture2D{};
+    window.clear();
+    active = false;
+}
+
+void PixelEngine::UnloadTargets()
+{
+    if (snapshot.id != 0)
+    {
+        UnloadRenderTexture(snapshot);
+    }
+    if (scratch.id != 0)
+    {
+        UnloadRenderTexture(scratch);
+    }
+    snapshot = RenderTexture2D{};
+    scratch = RenderTexture2D{};
+}
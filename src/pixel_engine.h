@@ -0,0 +1,77 @@
+#pragma once
+
+#include "raylib.h"
+#include "scene.h"
+
+#include <cstdint>
+#include <vector>
+
+// Alternative render engine that shades the canvas per pixel instead of
+// drawing drop outlines. It follows the scene's op log and, for every
+// pixel, walks the ops from newest to oldest through their inverse maps
+// until it lands inside the drop that owns the pixel. Cost scales with
+// pixels times ops rather than with vertices, and edges stay exact however
+// far marbling stretches a drop. Drops are not animated.
+//
+// Ops live in a float texture. Only the newest kMaxWindowOps are walked;
+// older ones are flattened into a snapshot texture that the walk samples
+// once it runs out of ops. The inverse maps are those of the baked layer
+// (see BakedLayer and warp_shader.h), so tines match the vertex engine only
+// approximately.
+//
+// GPU objects are created on first use and must be released with Unload()
+// while the GL context is still alive.
+class PixelEngine
+{
+public:
+    PixelEngine() = default;
+    ~PixelEngine() = default;
+    PixelEngine(const PixelEngine&) = delete;
+    PixelEngine& operator=(const PixelEngine&) = delete;
+
+    // False if the shader or float textures are not supported here.
+    bool IsAvailable();
+    // True while following a scene (between BeginCapture and Reset).
+    bool IsActive() const { return active; }
+    // Start following `scene`. Everything drawn between BeginCapture and
+    // EndCapture becomes the canvas before the scene's next op.
+    bool BeginCapture(MarblingScene& scene, int width, int height);
+    void EndCapture(MarblingScene& scene);
+    // Pick up ops recorded since the last call, resizing the snapshot first
+    // if the render area changed.
+    void Sync(MarblingScene& scene, int width, int height);
+    // Shade the whole canvas.
+    void Draw();
+    // Stop following the scene and drop the snapshot.
+    void Reset(MarblingScene& scene);
+    void Unload();
+
+    size_t WindowOps() const { return window.size(); }
+
+private:
+    bool EnsureGpu();
+    bool EnsureTargets(int width, int height);
+    void UploadOps(size_t count);
+    // Shade into the current render target from `source` and the first
+    // `count` uploaded ops.
+    void Shade(const RenderTexture2D& source, size_t count);
+    void Flatten(size_t count);
+    void UnloadTargets();
+
+    std::vector<MarbleOp> window;
+    std::vector<float> texels;
+    uint32_t cursor = 0;
+    bool active = false;
+    bool opsDirty = true;
+
+    Shader shader{};
+    Texture2D opTexture{};
+    RenderTexture2D snapshot{};
+    RenderTexture2D scratch{};
+    bool gpuFailed = false;
+    int opsLoc = -1;
+    int opsSizeLoc = -1;
+    int opCountLoc = -1;
+    int sizeLoc = -1;
+    int backgroundLoc = -1;
+};
@@ -0,0 +1,731 @@
+#include "scene.h"
+
+#include "job_system.h"
+#include "marble_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Drops that stay hidden keep ops alive in the log; past this length every
+// drop is brought up to date so the log cannot grow without bound.
+constexpr size_t kMaxPendingOps = 1024;
+constexpr float kIndexCellSize = 64.0f;
+// Drops added since the last index build are checked linearly up to this.
+constexpr uint32_t kMaxUnindexedDrops = 64;
+// Drops per job when resolving in parallel; replay cost varies a lot
+// between drops, so small chunks leave room for stealing.
+constexpr size_t kResolveGrain = 4;
+// Per-drop outcome of a parallel resolve.
+constexpr uint8_t kResolveChanged = 1;
+constexpr uint8_t kResolveNeedsGrow = 2;
+// Rake limits: the tine count fits MarbleOp::tines, and a spacing floor
+// bounds how many tines one vertex can sit between.
+constexpr int kMaxRakeTines = 1024;
+constexpr float kMinRakeSpacing = 1.0f;
+
+Rectangle Grow(const Rectangle& r, float by)
+{
+    return {r.x - by, r.y - by, r.width + 2.0f * by, r.height + 2.0f * by};
+}
+
+bool Overlaps(const Rectangle& a, const Rectangle& b, float grow)
+{
+    return a.x - grow < b.x + b.width && a.x + a.width + grow > b.x &&
+           a.y - grow < b.y + b.height && a.y + a.height + grow > b.y;
+}
+
+// True if `inner` grown by `grow` on every side still fits inside `outer`.
+bool Contains(const Rectangle& outer, const Rectangle& inner, float grow)
+{
+    return inner.x - grow >= outer.x && inner.y - grow >= outer.y &&
+           inner.x + inner.width + grow <= outer.x + outer.width &&
+           inner.y + inner.height + grow <= outer.y + outer.height;
+}
+} // namespace
+
+RemeshParams RemeshParamsForQuality(int quality)
+{
+    RemeshParams params;
+    if (quality <= 0)
+    {
+        params.maxEdge = 10.0f;
+        params.flatness = 0.25f;
+        params.maxVertices = 1024;
+    }
+    else if (quality >= 2)
+    {
+        params.maxEdge = 4.0f;
+        params.flatness = 0.06f;
+        params.maxVertices = 4096;
+    }
+    return params;
+}
+
+RemeshParams ScaleRemeshDetail(RemeshParams params, float detail)
+{
+    params.maxEdge /= detail;
+    params.minEdge /= detail;
+    params.flatness /= detail;
+    params.maxVertices = std::max(params.minVertices, static_cast<int>(static_cast<float>(params.maxVertices) * detail));
+    return params;
+}
+
+MarblingScene::MarblingScene()
+{
+    reach.push_back(0.0);
+}
+
+void MarblingScene::PushOp(const MarbleOp& op, float displacementBound)
+{
+    ops.push_back(op);
+    reach.push_back(reach.back() + displacementBound);
+}
+
+Drop& MarblingScene::AddDrop(float x, float y, color clr, double radius, int n)
+{
+    MarbleOp op;
+    op.kind = MarbleOp::DropInsert;
+    op.x = x;
+    op.y = y;
+    op.radius = static_cast<float>(radius);
+    op.rgba = PackColor(clr);
+    PushOp(op, MarbleDisplacementBound(op.radius));
+
+    // The new drop must not be displaced by its own insertion.
+    Drop& drop = drops.Emplace(x, y, clr, radius, n);
+    drop.setOpCursor(LogHead());
+    return drop;
+}
+
+void MarblingScene::AddTine(float x, float strength, float sharpness)
+{
+    const bool pinned = !pins.empty();
+    if (fabsf(strength) < 1e-5f || (drops.Empty() && !pinned))
+    {
+        return;
+    }
+    // A tine reaches at most max(sharpness, 8) px either side of x (see
+    // Drop::applyVerticalTine). Skip recording strokes that touch nothing,
+    // unless a pinned reader (which may hold no drops) still needs them.
+    const float band = TineBand(sharpness);
+    QueryDrops({x - band, -1e9f, 2.0f * band, 2e9f}, nearby);
+    if (nearby.empty() && !pinned)
+    {
+        return;
+    }
+
+    MarbleOp op;
+    op.kind = MarbleOp::VerticalTine;
+    op.x = x;
+    op.strength = strength;
+    op.sharpness = sharpness;
+    // Tine displacement (and its smoothing) never exceeds |strength|.
+    PushOp(op, fabsf(strength));
+}
+
+void MarblingScene::AddTineStroke(const Vector2* points, size_t count, float strength, float sharpness)
+{
+    const bool pinned = !pins.empty();
+    if (count < 2 || fabsf(strength) < 1e-5f || (drops.Empty() && !pinned))
+    {
+        return;
+    }
+    // One query for the whole stroke; pieces that pass no drop are recorded
+    // anyway and cost each drop a bounds test when it replays them.
+    const float reach = TineRamp(TineBand(sharpness), strength);
+    float minX = points[0].x, maxX = points[0].x, minY = points[0].y, maxY = points[0].y;
+    for (size_t i = 1; i < count; ++i)
+    {
+        minX = fminf(minX, points[i].x);
+        maxX = fmaxf(maxX, points[i].x);
+        minY = fminf(minY, points[i].y);
+        maxY = fmaxf(maxY, points[i].y);
+    }
+    QueryDrops({minX - reach, minY - reach, maxX - minX + 2.0f * reach, maxY - minY + 2.0f * reach}, nearby);
+    if (nearby.empty() && !pinned)
+    {
+        return;
+    }
+
+    for (size_t i = 1; i < count; ++i)
+    {
+        MarbleOp op;
+        op.kind = MarbleOp::TineSegment;
+        op.x = points[i - 1].x;
+        op.y = points[i - 1].y;
+        op.x1 = points[i].x;
+        op.y1 = points[i].y;
+        op.strength = strength;
+        op.sharpness = sharpness;
+        const float length = sqrtf((op.x1 - op.x) * (op.x1 - op.x) + (op.y1 - op.y) * (op.y1 - op.y));
+        if (length < 1e-4f)
+        {
+            continue;
+        }
+        // The window of a piece of length L never exceeds L times the
+        // steepest slope of S over the ramp (15/8 / 2r), nor 1.
+        PushOp(op, fabsf(strength) * fminf(1.0f, 0.9375f * length / reach));
+    }
+}
+
+void MarblingScene::AddRake(float x, float y, float angleDegrees, int tines, float spacing, float strength, float sharpness)
+{
+    const bool pinned = !pins.empty();
+    if (tines < 1 || fabsf(strength) < 1e-5f || (drops.Empty() && !pinned))
+    {
+        return;
+    }
+    MarbleOp op;
+    op.kind = MarbleOp::Rake;
+    op.x = x;
+    op.y = y;
+    const float angle = angleDegrees * static_cast<float>(PI / 180.0);
+    op.x1 = cosf(angle);
+    op.y1 = sinf(angle);
+    op.tines = static_cast<uint16_t>(std::min(tines, kMaxRakeTines));
+    op.spacing = fmaxf(spacing, kMinRakeSpacing);
+    op.strength = strength;
+    op.sharpness = sharpness;
+
+    // An axis-aligned comb covers a strip, like AddTine; skip recording it
+    // when it touches nothing. Slanted combs are left to each drop's bounds
+    // test.
+    const float band = TineBand(sharpness);
+    const float halfWidth = 0.5f * op.spacing * static_cast<float>(op.tines - 1) + band;
+    const bool vertical = fabsf(op.x1) < 1e-4f;
+    const bool horizontal = fabsf(op.y1) < 1e-4f;
+    if (vertical || horizontal)
+    {
+        const Rectangle strip = vertical ? Rectangle{x - halfWidth, -1e9f, 2.0f * halfWidth, 2e9f}
+                                         : Rectangle{-1e9f, y - halfWidth, 2e9f, 2.0f * halfWidth};
+        QueryDrops(strip, nearby);
+        if (nearby.empty() && !pinned)
+        {
+            return;
+        }
+    }
+    // A point lies within the band of at most 2 band / spacing + 1 tines.
+    const float overlap = fminf(static_cast<float>(op.tines), floorf(2.0f * band / op.spacing) + 1.0f);
+    PushOp(op, fabsf(strength) * overlap);
+}
+
+float MarblingScene::PendingReach(const Drop& drop) const
+{
+    const size_t first = drop.getOpCursor() - logBase;
+    return static_cast<float>(reach.back() - reach[first]);
+}
+
+bool MarblingScene::ResolveDrop(Drop& drop, bool* needsGrow)
+{
+    if (drop.isRetired())
+    {
+        drop.setOpCursor(LogHead());
+        return false;
+    }
+    const size_t first = drop.getOpCursor() - logBase;
+    const bool pending = first < ops.size();
+    if (pending)
+    {
+        // Ops apply to the committed outline, not to what the immediate-mode
+        // fallback deformed it into for the last frame, so the result does
+        // not depend on which frames were animated on the CPU.
+        drop.resetToBase();
+        if (drop.applyOps(ops.data() + first, ops.size() - first, farFieldTolerance) && remesh.enabled)
+        {
+            drop.remesh(remesh, needsGrow);
+        }
+    }
+    drop.setOpCursor(LogHead());
+    return pending;
+}
+
+bool MarblingScene::ResolveBatch(const std::vector<uint32_t>& indices)
+{
+    // Drops with pending ops are about to change, so the undo history gets
+    // its copies first. Retired drops only move their cursor.
+    const uint32_t head = LogHead();
+    for (const uint32_t index : indices)
+    {
+        const Drop& drop = drops[index];
+        if (!drop.isRetired() && drop.getOpCursor() != head)
+        {
+            history.Save(index, drop);
+        }
+    }
+
+    // Each job only touches its own drops and reads the log, so the result
+    // does not depend on how the range is split. Outlines that need a bigger
+    // pool block are finished below, on this thread, in index order.
+    resolveState.assign(indices.size(), 0);
+    JobSystem::Instance().ParallelFor(indices.size(), kResolveGrain, [this, &indices](size_t begin, size_t end)
+                                      {
+        for (size_t k = begin; k < end; ++k)
+        {
+            bool needsGrow = false;
+            if (ResolveDrop(drops[indices[k]], &needsGrow))
+            {
+                resolveState[k] = needsGrow ? kResolveChanged | kResolveNeedsGrow : kResolveChanged;
+            }
+        } });
+
+    bool changed = false;
+    for (size_t k = 0; k < indices.size(); ++k)
+    {
+        changed |= (resolveState[k] & kResolveChanged) != 0;
+        if (resolveState[k] & kResolveNeedsGrow)
+        {
+            drops[indices[k]].remesh(remesh);
+        }
+    }
+    return changed;
+}
+
+bool MarblingScene::RemeshRange(size_t first, size_t count)
+{
+    if (!remesh.enabled)
+    {
+        return false;
+    }
+    const size_t last = std::min(drops.Size(), first + count);
+    const uint32_t head = LogHead();
+    resolveList.clear();
+    for (size_t i = first; i < last; ++i)
+    {
+        const Drop& drop = drops[i];
+        if (!drop.isRetired() && drop.getOpCursor() == head)
+        {
+            resolveList.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    resolveState.assign(resolveList.size(), 0);
+    JobSystem::Instance().ParallelFor(resolveList.size(), kResolveGrain, [this](size_t begin, size_t end)
+                                      {
+        for (size_t k = begin; k < end; ++k)
+        {
+            bool needsGrow = false;
+            drops[resolveList[k]].resetToBase();
+            if (drops[resolveList[k]].remesh(remesh, &needsGrow) || needsGrow)
+            {
+                resolveState[k] = needsGrow ? kResolveChanged | kResolveNeedsGrow : kResolveChanged;
+            }
+        } });
+
+    bool changed = false;
+    for (size_t k = 0; k < resolveList.size(); ++k)
+    {
+        changed |= (resolveState[k] & kResolveChanged) != 0;
+        if (resolveState[k] & kResolveNeedsGrow)
+        {
+            drops[resolveList[k]].remesh(remesh);
+        }
+    }
+    // Freed tails are reclaimed by the next TrimLog().
+    return changed;
+}
+
+void MarblingScene::ResolveVisible(Rectangle viewport, float deformMargin, std::vector<uint32_t>& visible)
+{
+    visible.clear();
+    EnsureIndex(viewport, deformMargin);
+    QueryDrops(viewport, candidates);
+    resolveList.clear();
+    for (const uint32_t i : candidates)
+    {
+        const Drop& drop = drops[i];
+        if (drop.isRetired())
+        {
+            continue;
+        }
+        const float margin = deformMargin * static_cast<float>(drop.getRadius());
+        if (Overlaps(drop.getBounds(), viewport, margin + PendingReach(drop)))
+        {
+            resolveList.push_back(i);
+        }
+    }
+    const bool changed = ResolveBatch(resolveList);
+    for (const uint32_t i : resolveList)
+    {
+        // Bounds are exact again; the conservative test above may have let
+        // through a drop that in fact stays outside.
+        const Drop& drop = drops[i];
+        if (Overlaps(drop.getBounds(), viewport, deformMargin * static_cast<float>(drop.getRadius())))
+        {
+            visible.push_back(i);
+        }
+    }
+    // Coverage only changes when geometry does, so static frames skip the test.
+    if (changed && occlusionCulling)
+    {
+        RetireOccluded(visible, deformMargin);
+    }
+    TrimLog();
+}
+
+void MarblingScene::RetireOccluded(std::vector<uint32_t>& visible, float deformMargin)
+{
+    // Exact marbling maps the plane onto itself, so an older drop normally
+    // ends up around a newer one, not under it. Coverage happens where the
+    // displacement clamp pulls a small drop near a new drop's center inside
+    // it (any drop within ~0.17 r of the new center). Such a drop stays
+    // inside its cover under later ops, so it can be retired for good.
+    //
+    // The test is conservative: the covering drop must contain a disc around
+    // its center, and every vertex of the covered drop must lie inside that
+    // disc with room left for both drops' per-frame deformation.
+    size_t retiredNow = 0;
+    for (size_t top = visible.size(); top-- > 1;)
+    {
+        const Drop& cover = drops[visible[top]];
+        if (cover.isRetired() || !cover.isOpaque())
+        {
+            continue;
+        }
+        const float coverMargin = deformMargin * static_cast<float>(cover.getRadius());
+        float inscribed = -1.0f;
+        QueryDrops(cover.getBounds(), nearby);
+        for (const uint32_t below : nearby)
+        {
+            if (below >= visible[top])
+            {
+                break;
+            }
+            Drop& under = drops[below];
+            // Only drops resolved this frame have geometry to compare against.
+            if (under.isRetired() || under.getOpCursor() != LogHead())
+            {
+                continue;
+            }
+            const float margin = coverMargin + deformMargin * static_cast<float>(under.getRadius());
+            if (!Contains(cover.getBounds(), under.getBounds(), margin))
+            {
+                continue;
+            }
+            if (inscribed < 0.0f)
+            {
+                inscribed = cover.inscribedRadius();
+            }
+            if (under.farthestVertexFrom(cover.getCenter()) + margin <= inscribed)
+            {
+                history.Save(below, under);
+                under.retire();
+                ++retiredNow;
+            }
+        }
+    }
+    if (retiredNow == 0)
+    {
+        return;
+    }
+    retiredCount += retiredNow;
+    visible.erase(std::remove_if(visible.begin(), visible.end(), [this](uint32_t index)
+                                 { return drops[index].isRetired(); }),
+                  visible.end());
+}
+
+void MarblingScene::EnsureIndex(Rectangle viewport, float deformMargin)
+{
+    const bool sameView = viewport.x == indexViewport.x && viewport.y == indexViewport.y &&
+                          viewport.width == indexViewport.width && viewport.height == indexViewport.height;
+    const float slack = static_cast<float>(reach.back() - indexReach);
+    if (sameView && deformMargin == indexMargin && slack <= kIndexCellSize &&
+        drops.Size() - indexedDrops <= kMaxUnindexedDrops)
+    {
+        return;
+    }
+
+    indexBoxes.resize(drops.Size());
+    for (size_t i = 0; i < drops.Size(); ++i)
+    {
+        const Drop& drop = drops[i];
+        if (drop.isRetired())
+        {
+            indexBoxes[i] = {0.0f, 0.0f, -1.0f, -1.0f};
+            continue;
+        }
+        const float grow = deformMargin * static_cast<float>(drop.getRadius()) + PendingReach(drop);
+        indexBoxes[i] = Grow(drop.getBounds(), grow);
+    }
+    // Cover some space around the viewport so drops pushed just off screen
+    // do not all crowd into the border cells.
+    const Rectangle domain = Grow(viewport, 0.5f * fmaxf(viewport.width, viewport.height));
+    index.Build(domain, kIndexCellSize, indexBoxes);
+    indexViewport = viewport;
+    indexMargin = deformMargin;
+    indexReach = reach.back();
+    indexedDrops = static_cast<uint32_t>(drops.Size());
+}
+
+void MarblingScene::QueryDrops(Rectangle area, std::vector<uint32_t>& out)
+{
+    index.Query(Grow(area, static_cast<float>(reach.back() - indexReach)), out);
+    for (uint32_t i = indexedDrops; i < drops.Size(); ++i)
+    {
+        out.push_back(i);
+    }
+}
+
+int MarblingScene::PickDrop(float x, float y)
+{
+    QueryDrops({x, y, 0.0f, 0.0f}, nearby);
+    for (auto it = nearby.rbegin(); it != nearby.rend(); ++it)
+    {
+        Drop& drop = drops[*it];
+        if (drop.isRetired())
+        {
+            continue;
+        }
+        if (drop.getOpCursor() != LogHead())
+        {
+            history.Save(*it, drop);
+        }
+        ResolveDrop(drop);
+        if (drop.containsPoint({x, y}))
+        {
+            return static_cast<int>(*it);
+        }
+    }
+    return -1;
+}
+
+void MarblingScene::ResolveAll()
+{
+    ResolveEveryDrop();
+    TrimLog();
+}
+
+void MarblingScene::ResolveEveryDrop()
+{
+    resolveList.resize(drops.Size());
+    for (size_t i = 0; i < drops.Size(); ++i)
+    {
+        resolveList[i] = static_cast<uint32_t>(i);
+    }
+    ResolveBatch(resolveList);
+}
+
+uint32_t MarblingScene::OldestCursor() const
+{
+    uint32_t oldest = LogHead();
+    for (const LogPin& pin : pins)
+    {
+        oldest = std::min(oldest, pin.cursor);
+    }
+    for (const Drop& drop : drops)
+    {
+        if (!drop.isRetired())
+        {
+            oldest = std::min(oldest, drop.getOpCursor());
+        }
+    }
+    return oldest;
+}
+
+void MarblingScene::TrimLog()
+{
+    uint32_t oldest = OldestCursor();
+    if (LogHead() - oldest > kMaxPendingOps)
+    {
+        ResolveEveryDrop();
+        oldest = OldestCursor();
+    }
+    pendingBase = oldest;
+
+    // Remeshing frees blocks as drops change size; reclaim them here, between
+    // resolves, where no drop holds pointers into the pool.
+    drops.MaybeCompact();
+
+    // Copies in the undo history may have to replay older ops once restored.
+    history.Trim(LogHead());
+    oldest = std::min(oldest, history.LogFloor(LogHead()));
+    const size_t consumed = oldest - logBase;
+    if (consumed == 0)
+    {
+        return;
+    }
+    ops.erase(ops.begin(), ops.begin() + static_cast<std::ptrdiff_t>(consumed));
+    reach.erase(reach.begin(), reach.begin() + static_cast<std::ptrdiff_t>(consumed));
+    logBase = oldest;
+}
+
+void MarblingScene::Clear()
+{
+    drops.Clear();
+    ops.clear();
+    reach.assign(1, 0.0);
+    logBase = 0;
+    pendingBase = 0;
+    pins.clear();
+    history.Clear();
+    retiredCount = 0;
+    ResetIndex();
+    indexReach = 0.0;
+}
+
+void MarblingScene::ResetIndex()
+{
+    index.Clear();
+    indexViewport = {};
+    indexMargin = -1.0f;
+    indexedDrops = 0;
+}
+
+const MarbleOp* MarblingScene::OpsSince(uint32_t cursor, size_t& count) const
+{
+    const size_t first = cursor - logBase;
+    count = ops.size() - first;
+    return ops.data() + first;
+}
+
+void MarblingScene::PinLog(const void* reader, uint32_t cursor)
+{
+    for (LogPin& pin : pins)
+    {
+        if (pin.reader == reader)
+        {
+            pin.cursor = cursor;
+            return;
+        }
+    }
+    pins.push_back({reader, cursor});
+}
+
+void MarblingScene::UnpinLog(const void* reader)
+{
+    pins.erase(std::remove_if(pins.begin(), pins.end(), [reader](const LogPin& pin)
+                              { return pin.reader == reader; }),
+               pins.end());
+}
+
+void MarblingScene::EvictPrefix(size_t count)
+{
+    count = std::min(count, drops.Size());
+    if (count == 0)
+    {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        drops[i].retire();
+    }
+    drops.ErasePrefix(count);
+    // Every index moved: rebuild the spatial index from scratch, and the
+    // history, which refers to drops by index, starts over.
+    ResetIndex();
+    history.Clear();
+}
+
+void MarblingScene::Checkpoint()
+{
+    history.Open(LogHead(), drops.Size());
+}
+
+bool MarblingScene::Undo()
+{
+    SceneHistory::Entry* entry = history.UndoTarget(LogHead(), drops.Size());
+    if (!entry)
+    {
+        return false;
+    }
+    for (const LogPin& pin : pins)
+    {
+        if (pin.cursor > entry->head)
+        {
+            return false;
+        }
+    }
+
+    // What the action did, kept for Redo: the drops it changed as they are
+    // now, the drops it added and the ops it recorded.
+    SceneHistory::Entry done;
+    done.head = entry->head;
+    done.dropCount = entry->dropCount;
+    for (const uint32_t index : entry->drops.indices)
+    {
+        done.drops.Add(index, drops[index]);
+    }
+    for (size_t i = entry->dropCount; i < drops.Size(); ++i)
+    {
+        done.drops.Add(static_cast<uint32_t>(i), drops[i]);
+        if (drops[i].isRetired())
+        {
+            --retiredCount;
+        }
+    }
+    const size_t keep = entry->head - logBase;
+    done.ops.assign(ops.begin() + static_cast<std::ptrdiff_t>(keep), ops.end());
+    done.reach.assign(reach.begin() + static_cast<std::ptrdiff_t>(keep + 1), reach.end());
+
+    RestoreDrops(entry->drops);
+    drops.Truncate(entry->dropCount);
+    ops.resize(keep);
+    reach.resize(keep + 1);
+    pendingBase = std::min(pendingBase, entry->head);
+    history.FinishUndo(std::move(done));
+    ResetIndex();
+    return true;
+}
+
+bool MarblingScene::Redo()
+{
+    if (!history.CanRedo())
+    {
+        return false;
+    }
+    SceneHistory::Entry done = history.TakeRedo();
+    if (done.head != LogHead() || done.dropCount != drops.Size())
+    {
+        // The scene moved on without a checkpoint; this step no longer fits.
+        history.ClearRedo();
+        return false;
+    }
+    // Undoing this again needs the changed drops as they are now.
+    history.Open(LogHead(), drops.Size(), true);
+    for (const uint32_t index : done.drops.indices)
+    {
+        if (index < done.dropCount)
+        {
+            history.Save(index, drops[index]);
+        }
+    }
+    RestoreDrops(done.drops);
+    ops.insert(ops.end(), done.ops.begin(), done.ops.end());
+    reach.insert(reach.end(), done.reach.begin(), done.reach.end());
+    ResetIndex();
+    history.Trim(LogHead());
+    return true;
+}
+
+void MarblingScene::RestoreDrops(const SceneHistory::Snapshot& snapshot)
+{
+    for (size_t i = 0; i < snapshot.indices.size(); ++i)
+    {
+        const uint32_t index = snapshot.indices[i];
+        const Drop& saved = snapshot.records[i];
+        const float* xs = snapshot.points.data() + snapshot.starts[i];
+        const float* ys = xs + saved.getVertexCount();
+        if (index >= drops.Size())
+        {
+            // Redo re-adds drops in index order; restore() fills in the rest.
+            drops.Emplace(saved.getCenter().x, saved.getCenter().y, saved.getColor(), saved.getRadius(),
+                          std::max(saved.getVertexCount(), 3));
+        }
+        Drop& drop = drops[index];
+        if (saved.isRetired() && !drop.isRetired())
+        {
+            ++retiredCount;
+        }
+        else if (!saved.isRetired() && drop.isRetired())
+        {
+            --retiredCount;
+        }
+        drop.restore(saved, xs, ys);
+    }
+}
+
+void MarblingScene::SetHistoryLimits(size_t levels, size_t bytes)
+{
+    history.SetLimits(levels, bytes);
+    history.Trim(LogHead());
+}
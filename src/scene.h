@@ -0,0 +1,174 @@
+#pragma once
+
+#include "drop_store.h"
+#include "raylib.h"
+#include "scene_history.h"
+#include "spatial_grid.h"
+
+#include <cstdint>
+#include <vector>
+
+// Outline resampling for a quality level (0 performance, 1 balanced,
+// 2 high), shared by the app's quality modes and headless renders.
+RemeshParams RemeshParamsForQuality(int quality);
+// Coarsen remesh limits to a fraction of full detail: longer chords, looser
+// flatness and fewer vertices per outline.
+RemeshParams ScaleRemeshDetail(RemeshParams params, float detail);
+
+// Drops plus the log of marbling operations that have not reached every drop
+// yet. Adding a drop or a tine is an O(1) append; each drop replays its
+// pending ops (fused into one pass where possible) only when its geometry is
+// needed for drawing. Bursts of input therefore cost one memory pass, and
+// drops that stay out of view do not pay until they come back.
+class MarblingScene
+{
+public:
+    MarblingScene();
+
+    Drop& AddDrop(float x, float y, color clr, double radius, int n);
+    void AddTine(float x, float strength, float sharpness);
+    // A stylus stroke through `count` points, recorded as one TineSegment op
+    // per piece (see MarbleOp). Continue a stroke by starting the next call
+    // at the previous call's last point.
+    void AddTineStroke(const Vector2* points, size_t count, float strength, float sharpness);
+    // A comb of `tines` parallel tines `spacing` px apart, centered on (x, y)
+    // and pulled by `strength` px along `angleDegrees` (0 is +x, 90 is +y),
+    // recorded as one Rake op (see MarbleOp).
+    void AddRake(float x, float y, float angleDegrees, int tines, float spacing, float strength, float sharpness);
+
+    // Bring every drop that may intersect `viewport` up to date and collect
+    // their indices in paint order. `deformMargin` is the reach of per-frame
+    // deformations applied after resolving, as a fraction of drop radius.
+    void ResolveVisible(Rectangle viewport, float deformMargin, std::vector<uint32_t>& visible);
+    void ResolveAll();
+    void Clear();
+
+    // Index of the topmost drop whose outline contains (x, y), or -1.
+    int PickDrop(float x, float y);
+
+    // Outline resampling applied to each drop after it replays ops.
+    void SetRemeshParams(const RemeshParams& params) { remesh = params; }
+    const RemeshParams& GetRemeshParams() const { return remesh; }
+
+    // Far-field marbling: insertions far enough from a drop are applied as
+    // one composed affine map per run, bounded to err by at most `pixels`
+    // per run against the exact kernel (see MarbleLinearize). Near drops
+    // still get the exact kernel; 0 applies it everywhere.
+    void SetFarFieldTolerance(float pixels) { farFieldTolerance = pixels > 0.0f ? pixels : 0.0f; }
+    float GetFarFieldTolerance() const { return farFieldTolerance; }
+
+    // When enabled, drops found to lie completely under a later opaque drop
+    // (including the reach of both drops' per-frame deformation) are retired:
+    // their geometry is released and they are no longer marbled or drawn.
+    void SetOcclusionCulling(bool enabled) { occlusionCulling = enabled; }
+    size_t RetiredCount() const { return retiredCount; }
+
+    // Resample drops [first, first + count) with the current remesh params,
+    // for adapting existing outlines after SetRemeshParams. Drops with
+    // pending ops are skipped; they are resampled when they resolve. Both
+    // merging and linear subdivision keep outlines inside their old bounds,
+    // so the spatial index stays valid. Returns true if any outline changed.
+    bool RemeshRange(size_t first, size_t count);
+    // Resolve the listed drops (ascending indices) regardless of visibility.
+    void ResolveDrops(const std::vector<uint32_t>& indices) { ResolveBatch(indices); }
+    // Retire the first `count` drops and drop them from the store. Later
+    // drops shift down by `count`, so callers holding drop indices must
+    // rebase them.
+    void EvictPrefix(size_t count);
+
+    // Undo history (see SceneHistory). Checkpoint() marks the start of a user
+    // action; Undo() and Redo() step over whole actions, restoring only the
+    // drops an action changed. Clear() and EvictPrefix() forget the history.
+    // Undo fails while a reader is pinned past the ops it would remove.
+    void Checkpoint();
+    bool Undo();
+    bool Redo();
+    bool CanUndo() const { return history.CanUndo(LogHead(), drops.Size()); }
+    bool CanRedo() const { return history.CanRedo(); }
+    // At most `levels` undo steps (0 turns the history off) holding about
+    // `bytes` of copies; the oldest steps go first.
+    void SetHistoryLimits(size_t levels, size_t bytes);
+    size_t HistoryLevels() const { return history.Levels(); }
+    size_t HistoryBytes() const { return history.Bytes(LogHead()); }
+
+    // Sequence number the next recorded op will get.
+    uint32_t LogHead() const { return logBase + static_cast<uint32_t>(ops.size()); }
+    // Ops recorded since `cursor` (a previous LogHead()), oldest first. A
+    // reader outside the scene pins its cursor so TrimLog keeps those ops;
+    // while any reader is pinned, ops are recorded even when no drop is in
+    // their reach. Clear() drops every pin.
+    const MarbleOp* OpsSince(uint32_t cursor, size_t& count) const;
+    void PinLog(const void* reader, uint32_t cursor);
+    void UnpinLog(const void* reader);
+    // Forget ops every drop and reader has consumed. ResolveVisible() does
+    // this; callers that draw without it must call it to bound the log.
+    void TrimLog();
+
+    DropStore& Drops() { return drops; }
+    const DropStore& Drops() const { return drops; }
+    // Ops recorded since the oldest drop or reader cursor seen by the last
+    // TrimLog(); ops kept only for the undo history do not count.
+    size_t PendingOps() const { return LogHead() - pendingBase; }
+
+private:
+    struct LogPin
+    {
+        const void* reader;
+        uint32_t cursor;
+    };
+
+    void PushOp(const MarbleOp& op, float displacementBound);
+    // Returns true if the drop had pending ops to apply. `needsGrow` is
+    // passed through to Drop::remesh for calls made from worker threads.
+    bool ResolveDrop(Drop& drop, bool* needsGrow = nullptr);
+    // Resolve the listed drops on the job system; true if any changed.
+    bool ResolveBatch(const std::vector<uint32_t>& indices);
+    void ResolveEveryDrop();
+    // Oldest op cursor of a live drop or pinned reader.
+    uint32_t OldestCursor() const;
+    // Put saved drops back, appending those past the end (see
+    // SceneHistory::Entry).
+    void RestoreDrops(const SceneHistory::Snapshot& snapshot);
+    // Forget the spatial index after drops moved or went away; the next
+    // query scans linearly and the next ResolveVisible() rebuilds it.
+    void ResetIndex();
+    void RetireOccluded(std::vector<uint32_t>& visible, float deformMargin);
+    // Rebuild the spatial index when the viewport or margin changed, too many
+    // drops were added since the last build, or ops recorded since then may
+    // have moved drops further than the index tolerates.
+    void EnsureIndex(Rectangle viewport, float deformMargin);
+    // Drops that may overlap `area`, ascending (paint order). Conservative:
+    // callers still test the drop's own bounds.
+    void QueryDrops(Rectangle area, std::vector<uint32_t>& out);
+    // Upper bound on how far the drop's unapplied ops can move its vertices.
+    float PendingReach(const Drop& drop) const;
+
+    DropStore drops;
+    // ops[i] has sequence number logBase + i.
+    std::vector<MarbleOp> ops;
+    // reach[i] is the summed displacement bound of all ops before sequence
+    // logBase + i, so the reach of any pending suffix is a subtraction.
+    std::vector<double> reach;
+    uint32_t logBase = 0;
+    uint32_t pendingBase = 0;
+    std::vector<LogPin> pins;
+    SceneHistory history;
+    RemeshParams remesh;
+    float farFieldTolerance = 0.1f;
+    bool occlusionCulling = true;
+    size_t retiredCount = 0;
+
+    // Boxes are drop bounds grown by pending reach and deformation margin at
+    // build time. Ops recorded afterwards can move any drop by at most the
+    // reach added since, so queries grow by that slack instead of rebuilding.
+    SpatialGrid index;
+    std::vector<Rectangle> indexBoxes;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> resolveList;
+    std::vector<uint8_t> resolveState;
+    std::vector<uint32_t> nearby;
+    Rectangle indexViewport{};
+    float indexMargin = -1.0f;
+    double indexReach = 0.0;
+    uint32_t indexedDrops = 0;
+};
@@ -0,0 +1,196 @@
+#include "scene_history.h"
+
+#include <algorithm>
+
+void SceneHistory::Snapshot::Add(uint32_t index, const Drop& drop)
+{
+    indices.push_back(index);
+    records.push_back(drop);
+    starts.push_back(points.size());
+    if (!drop.isRetired())
+    {
+        const size_t n = static_cast<size_t>(drop.getVertexCount());
+        points.insert(points.end(), drop.getBaseX(), drop.getBaseX() + n);
+        points.insert(points.end(), drop.getBaseY(), drop.getBaseY() + n);
+    }
+}
+
+size_t SceneHistory::Snapshot::Bytes() const
+{
+    return indices.size() * sizeof(uint32_t) + records.size() * sizeof(Drop) + starts.size() * sizeof(size_t) +
+           points.size() * sizeof(float);
+}
+
+size_t SceneHistory::Entry::Bytes() const
+{
+    return sizeof(Entry) + drops.Bytes() + ops.size() * sizeof(MarbleOp) + reach.size() * sizeof(double);
+}
+
+void SceneHistory::SetLimits(size_t levels, size_t bytes)
+{
+    maxLevels = levels;
+    maxBytes = bytes;
+    if (maxLevels == 0)
+    {
+        Clear();
+    }
+}
+
+void SceneHistory::Clear()
+{
+    undo.clear();
+    redo.clear();
+    savedIn.clear();
+}
+
+void SceneHistory::Open(uint32_t head, size_t dropCount, bool keepRedo)
+{
+    if (maxLevels == 0)
+    {
+        return;
+    }
+    if (!keepRedo)
+    {
+        redo.clear();
+    }
+    if (!undo.empty() && Idle(undo.back(), head, dropCount))
+    {
+        return;
+    }
+    Entry entry;
+    entry.serial = nextSerial++;
+    entry.head = head;
+    entry.dropCount = static_cast<uint32_t>(dropCount);
+    entry.floor = head;
+    undo.push_back(std::move(entry));
+    if (savedIn.size() < dropCount)
+    {
+        savedIn.resize(dropCount, 0);
+    }
+    Trim(head);
+}
+
+void SceneHistory::SaveSlow(uint32_t index, const Drop& drop)
+{
+    Entry& top = undo.back();
+    savedIn[index] = top.serial;
+    top.drops.Add(index, drop);
+    if (!drop.isRetired())
+    {
+        top.floor = std::min(top.floor, drop.getOpCursor());
+    }
+}
+
+bool SceneHistory::CanUndo(uint32_t head, size_t dropCount) const
+{
+    return !undo.empty() && (undo.size() > 1 || !Idle(undo.back(), head, dropCount));
+}
+
+SceneHistory::Entry* SceneHistory::UndoTarget(uint32_t head, size_t dropCount)
+{
+    if (undo.empty())
+    {
+        return nullptr;
+    }
+    if (Idle(undo.back(), head, dropCount))
+    {
+        if (undo.size() == 1)
+        {
+            return nullptr;
+        }
+        // Nothing was recorded after the idle entry opened, so its copies are
+        // also how those drops looked when the entry below opened, unless
+        // that entry holds an older copy already. (Open never stacks two
+        // idle entries, so one fold is enough.)
+        Entry idle = std::move(undo.back());
+        undo.pop_back();
+        MarkTop();
+        Entry& below = undo.back();
+        const Snapshot& from = idle.drops;
+        for (size_t i = 0; i < from.indices.size(); ++i)
+        {
+            const uint32_t index = from.indices[i];
+            if (index >= below.dropCount || savedIn[index] == below.serial)
+            {
+                continue;
+            }
+            const Drop& record = from.records[i];
+            const size_t n = record.isRetired() ? 0 : static_cast<size_t>(record.getVertexCount());
+            below.drops.indices.push_back(index);
+            below.drops.records.push_back(record);
+            below.drops.starts.push_back(below.drops.points.size());
+            below.drops.points.insert(below.drops.points.end(), from.points.begin() + static_cast<std::ptrdiff_t>(from.starts[i]),
+                                      from.points.begin() + static_cast<std::ptrdiff_t>(from.starts[i] + 2 * n));
+            if (n > 0)
+            {
+                below.floor = std::min(below.floor, record.getOpCursor());
+            }
+            savedIn[index] = below.serial;
+        }
+    }
+    return &undo.back();
+}
+
+void SceneHistory::FinishUndo(Entry&& done)
+{
+    undo.pop_back();
+    redo.push_back(std::move(done));
+    MarkTop();
+}
+
+SceneHistory::Entry SceneHistory::TakeRedo()
+{
+    Entry entry = std::move(redo.back());
+    redo.pop_back();
+    return entry;
+}
+
+void SceneHistory::MarkTop()
+{
+    if (undo.empty())
+    {
+        return;
+    }
+    const Entry& top = undo.back();
+    for (const uint32_t index : top.drops.indices)
+    {
+        savedIn[index] = top.serial;
+    }
+}
+
+uint32_t SceneHistory::LogFloor(uint32_t head) const
+{
+    uint32_t floor = head;
+    for (const Entry& entry : undo)
+    {
+        floor = std::min(floor, entry.floor);
+    }
+    return floor;
+}
+
+size_t SceneHistory::Bytes(uint32_t head) const
+{
+    size_t bytes = (head - LogFloor(head)) * (sizeof(MarbleOp) + sizeof(double));
+    for (const Entry& entry : undo)
+    {
+        bytes += entry.Bytes();
+    }
+    for (const Entry& entry : redo)
+    {
+        bytes += entry.Bytes();
+    }
+    return bytes;
+}
+
+void SceneHistory::Trim(uint32_t head)
+{
+    while (!undo.empty() && (undo.size() > maxLevels || Bytes(head) > maxBytes))
+    {
+        undo.pop_front();
+    }
+    // Undo steps go first: redo only matters until the next action.
+    while (!redo.empty() && Bytes(head) > maxBytes)
+    {
+        redo.erase(redo.begin());
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "drops.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Undo and redo storage for MarblingScene. An entry is opened per user
+// action and remembers the log head and drop count at that point. A drop is
+// copied into the newest entry (its record and committed outline) only when
+// it is about to change for the first time since the entry was opened, so
+// drops an action never reaches cost nothing and keep sharing their pool
+// block with the live scene. Drops the action adds are not copied either;
+// undo simply removes them.
+//
+// Copies are taken when drops resolve, not when the action is recorded, so
+// recording stays O(1) and the copying is spread over the frames that draw
+// the affected drops anyway. The scene does the restoring; this class owns
+// the entries and enforces the level and byte limits, dropping the oldest
+// entries first.
+class SceneHistory
+{
+public:
+    static constexpr size_t kDefaultLevels = 128;
+    static constexpr size_t kDefaultBytes = size_t(64) << 20;
+
+    // Some drops as they were at one point, with their committed outlines.
+    struct Snapshot
+    {
+        std::vector<uint32_t> indices;
+        std::vector<Drop> records;
+        // Outline of records[i]: getVertexCount() x values then as many y
+        // values, from points[starts[i]]. Retired drops have none.
+        std::vector<size_t> starts;
+        std::vector<float> points;
+
+        void Add(uint32_t index, const Drop& drop);
+        size_t Bytes() const;
+    };
+
+    struct Entry
+    {
+        uint32_t serial = 0;
+        // LogHead() and drop count when the action began.
+        uint32_t head = 0;
+        uint32_t dropCount = 0;
+        // Oldest op a restored drop may still have to replay.
+        uint32_t floor = 0;
+        // Undo entries: drops below dropCount as they were before the
+        // action first changed them. Redo entries: those drops as the
+        // action left them, then the drops it added.
+        Snapshot drops;
+        // Redo entries only: the ops the action recorded, and reach[] of the
+        // scene after each of them.
+        std::vector<MarbleOp> ops;
+        std::vector<double> reach;
+
+        size_t Bytes() const;
+    };
+
+    // `levels` undo steps at most (0 turns the history off) and about
+    // `bytes` of copies, including the ops kept alive for them.
+    void SetLimits(size_t levels, size_t bytes);
+    size_t MaxLevels() const { return maxLevels; }
+    size_t MaxBytes() const { return maxBytes; }
+    void Clear();
+
+    // Start an entry for an action beginning at `head` with `dropCount`
+    // drops. If nothing was recorded since the newest entry was opened, that
+    // entry is reused. A new action also forgets what could be redone.
+    void Open(uint32_t head, size_t dropCount, bool keepRedo = false);
+    // Copy drop `index` into the newest entry unless it already holds it or
+    // the drop was added after the entry was opened. Call before changing it.
+    void Save(uint32_t index, const Drop& drop)
+    {
+        if (!undo.empty() && index < undo.back().dropCount && savedIn[index] != undo.back().serial)
+        {
+            SaveSlow(index, drop);
+        }
+    }
+
+    bool CanUndo(uint32_t head, size_t dropCount) const;
+    bool CanRedo() const { return !redo.empty(); }
+    // The entry Undo should restore, or null. An idle newest entry is folded
+    // into the one before it first.
+    Entry* UndoTarget(uint32_t head, size_t dropCount);
+    // Drop the entry UndoTarget returned and keep `done` for Redo.
+    void FinishUndo(Entry&& done);
+    Entry TakeRedo();
+    void ClearRedo() { redo.clear(); }
+
+    // Oldest op the entries still need, or `head` if none.
+    uint32_t LogFloor(uint32_t head) const;
+    // Drop the oldest entries while over either limit.
+    void Trim(uint32_t head);
+    size_t Bytes(uint32_t head) const;
+    size_t Levels() const { return undo.size(); }
+
+private:
+    void SaveSlow(uint32_t index, const Drop& drop);
+    // True if nothing happened since `entry` was opened.
+    static bool Idle(const Entry& entry, uint32_t head, size_t dropCount)
+    {
+        return entry.head == head && entry.dropCount == dropCount;
+    }
+    // Point savedIn at the newest entry again after entries above it went.
+    void MarkTop();
+
+    std::deque<Entry> undo;
+    // Newest undone action last.
+    std::vector<Entry> redo;
+    // Serial of the newest entry each drop was saved into (0: none).
+    std::vector<uint32_t> savedIn;
+    uint32_t nextSerial = 1;
+    size_t maxLevels = kDefaultLevels;
+    size_t maxBytes = kDefaultBytes;
+};
@@ -0,0 +1,244 @@
+#include "scene_script.h"
+
+#include "colors.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+constexpr int kMaxOutputSide = 16384;
+// Resolve periodically so long scripts keep a short op log.
+constexpr size_t kResolveEveryOps = 1024;
+
+bool Fail(std::string& error, int line, const std::string& message)
+{
+    error = "line " + std::to_string(line) + ": " + message;
+    return false;
+}
+
+color PaletteColor(const ColorPalette::Palette& palette, std::mt19937& rng)
+{
+    if (palette.empty())
+    {
+        return color(255, 255, 255, 255);
+    }
+    const auto& value = palette[std::uniform_int_distribution<size_t>(0, palette.size() - 1)(rng)];
+    return color(value[0], value[1], value[2], value[3]);
+}
+} // namespace
+
+bool ParseSceneScript(const std::string& text, SceneScript& script, std::string& error)
+{
+    std::istringstream input(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(input, line))
+    {
+        ++lineNumber;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.resize(comment);
+        }
+        std::istringstream words(line);
+        std::string command;
+        if (!(words >> command))
+        {
+            continue;
+        }
+
+        if (command == "size")
+        {
+            if (!(words >> script.width >> script.height) || script.width < 1 || script.height < 1 ||
+                script.width > kMaxOutputSide || script.height > kMaxOutputSide)
+                return Fail(error, lineNumber, "size needs two sides in 1.." + std::to_string(kMaxOutputSide));
+        }
+        else if (command == "seed")
+        {
+            if (!(words >> script.seed))
+                return Fail(error, lineNumber, "seed needs a number");
+        }
+        else if (command == "palette")
+        {
+            if (!(words >> script.paletteIndex) || script.paletteIndex < 0)
+                return Fail(error, lineNumber, "palette needs an index");
+        }
+        else if (command == "vertices")
+        {
+            if (!(words >> script.vertices) || script.vertices < 3)
+                return Fail(error, lineNumber, "vertices needs a count of at least 3");
+        }
+        else if (command == "quality")
+        {
+            if (!(words >> script.quality))
+                return Fail(error, lineNumber, "quality needs 0, 1 or 2");
+            script.quality = std::clamp(script.quality, 0, 2);
+        }
+        else if (command == "background")
+        {
+            int r = 0, g = 0, b = 0;
+            if (!(words >> r >> g >> b))
+                return Fail(error, lineNumber, "background needs r g b");
+            script.background = {static_cast<unsigned char>(std::clamp(r, 0, 255)), static_cast<unsigned char>(std::clamp(g, 0, 255)),
+                                 static_cast<unsigned char>(std::clamp(b, 0, 255)), 255};
+        }
+        else if (command == "output")
+        {
+            if (!(words >> script.output))
+                return Fail(error, lineNumber, "output needs a file name");
+        }
+        else if (command == "drop")
+        {
+            ScriptCommand drop;
+            drop.kind = ScriptCommand::Drop;
+            if (!(words >> drop.x >> drop.y >> drop.radius) || drop.radius <= 0.0f)
+                return Fail(error, lineNumber, "drop needs x y radius");
+            int r = 0, g = 0, b = 0, a = 255;
+            if (words >> r)
+            {
+                if (!(words >> g >> b))
+                    return Fail(error, lineNumber, "drop color needs r g b [a]");
+                if (!(words >> a))
+                    a = 255;
+                drop.hasColor = true;
+                drop.clr = color(std::clamp(r, 0, 255), std::clamp(g, 0, 255), std::clamp(b, 0, 255), std::clamp(a, 0, 255));
+            }
+            script.commands.push_back(drop);
+        }
+        else if (command == "tine")
+        {
+            ScriptCommand tine;
+            tine.kind = ScriptCommand::Tine;
+            if (!(words >> tine.x >> tine.strength >> tine.sharpness))
+                return Fail(error, lineNumber, "tine needs x strength sharpness");
+            script.commands.push_back(tine);
+        }
+        else if (command == "stroke")
+        {
+            ScriptCommand stroke;
+            stroke.kind = ScriptCommand::Stroke;
+            if (!(words >> stroke.strength >> stroke.sharpness))
+                return Fail(error, lineNumber, "stroke needs strength sharpness and points");
+            Vector2 point{};
+            while (words >> point.x)
+            {
+                if (!(words >> point.y))
+                    return Fail(error, lineNumber, "stroke point needs x and y");
+                stroke.points.push_back(point);
+            }
+            if (stroke.points.size() < 2)
+                return Fail(error, lineNumber, "stroke needs at least two points");
+            script.commands.push_back(stroke);
+        }
+        else if (command == "rake")
+        {
+            ScriptCommand rake;
+            rake.kind = ScriptCommand::Rake;
+            if (!(words >> rake.x >> rake.y >> rake.angle >> rake.count >> rake.spacing >> rake.strength >> rake.sharpness) ||
+                rake.count < 1 || rake.spacing <= 0.0f)
+                return Fail(error, lineNumber, "rake needs x y angle tines spacing strength sharpness");
+            script.commands.push_back(rake);
+        }
+        else if (command == "random_drops")
+        {
+            ScriptCommand burst;
+            burst.kind = ScriptCommand::RandomDrops;
+            if (!(words >> burst.count >> burst.minRadius >> burst.maxRadius) || burst.count < 0 ||
+                burst.minRadius <= 0.0f || burst.maxRadius < burst.minRadius)
+                return Fail(error, lineNumber, "random_drops needs count minRadius maxRadius");
+            script.commands.push_back(burst);
+        }
+        else
+        {
+            return Fail(error, lineNumber, "unknown command '" + command + "'");
+        }
+    }
+    return true;
+}
+
+bool LoadSceneScript(const std::string& path, SceneScript& script, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    if (!ParseSceneScript(text.str(), script, error))
+    {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+void BuildScene(const SceneScript& script, MarblingScene& scene)
+{
+    scene.Clear();
+    scene.SetRemeshParams(RemeshParamsForQuality(script.quality));
+    const auto& palettes = ColorPalette::getAllPalettes();
+    static const ColorPalette::Palette kNoPalette;
+    const ColorPalette::Palette& palette = palettes.empty() ? kNoPalette : palettes[static_cast<size_t>(script.paletteIndex) % palettes.size()];
+    std::mt19937 rng(script.seed);
+
+    auto addDrop = [&](float x, float y, float radius, const color* clr)
+    {
+        scene.AddDrop(x, y, clr ? *clr : PaletteColor(palette, rng), radius, script.vertices);
+        if (scene.PendingOps() >= kResolveEveryOps)
+        {
+            scene.ResolveAll();
+        }
+    };
+    for (const ScriptCommand& command : script.commands)
+    {
+        switch (command.kind)
+        {
+        case ScriptCommand::Drop:
+            addDrop(command.x, command.y, command.radius, command.hasColor ? &command.clr : nullptr);
+            break;
+        case ScriptCommand::Tine:
+            scene.AddTine(command.x, command.strength, command.sharpness);
+            break;
+        case ScriptCommand::Stroke:
+            scene.AddTineStroke(command.points.data(), command.points.size(), command.strength, command.sharpness);
+            break;
+        case ScriptCommand::Rake:
+            scene.AddRake(command.x, command.y, command.angle, command.count, command.spacing, command.strength, command.sharpness);
+            break;
+        case ScriptCommand::RandomDrops:
+        {
+            std::uniform_real_distribution<float> xs(0.0f, static_cast<float>(script.width));
+            std::uniform_real_distribution<float> ys(0.0f, static_cast<float>(script.height));
+            std::uniform_real_distribution<float> radii(command.minRadius, command.maxRadius);
+            for (int i = 0; i < command.count; ++i)
+            {
+                const float x = xs(rng);
+                const float y = ys(rng);
+                addDrop(x, y, radii(rng), nullptr);
+            }
+            break;
+        }
+        }
+    }
+    scene.ResolveAll();
+}
+
+void RenderScene(const MarblingScene& scene, Color background, CpuCanvas& canvas)
+{
+    canvas.Clear(background);
+    for (const Drop& drop : scene.Drops())
+    {
+        if (drop.isRetired())
+        {
+            continue;
+        }
+        const color clr = drop.getColor();
+        const Color fill = {static_cast<unsigned char>(clr.r), static_cast<unsigned char>(clr.g), static_cast<unsigned char>(clr.b), static_cast<unsigned char>(clr.a)};
+        canvas.FillPolygon(drop.getBaseX(), drop.getBaseY(), drop.getVertexCount(), fill);
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "cpu_raster.h"
+#include "drops.h"
+#include "scene.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Plain-text scene description for headless renders. One command per line,
+// '#' starts a comment:
+//
+//   size <width> <height>             output size in pixels (default 1024 1024)
+//   seed <n>                          seeds every random choice (default 1)
+//   palette <index>                   palette for drops without a color
+//   vertices <n>                      vertices per new drop (default 400)
+//   quality <0|1|2>                   remesh quality, as in setQualityMode
+//   background <r> <g> <b>            canvas color (default raylib RAYWHITE)
+//   output <file.png>                 output path, relative to the script
+//   drop <x> <y> <radius> [r g b [a]] one drop; palette color if omitted
+//   tine <x> <strength> <sharpness>   one vertical tine stroke
+//   stroke <strength> <sharpness> <x0> <y0> <x1> <y1> [<x> <y> ...]
+//                                     a tine dragged along a polyline
+//   rake <x> <y> <angle> <tines> <spacing> <strength> <sharpness>
+//                                     a comb centered on x y, pulled along
+//                                     angle degrees (90 is down)
+//   random_drops <count> <minRadius> <maxRadius>
+//                                     seeded drops anywhere on the canvas
+//
+// Commands replay in file order.
+struct ScriptCommand
+{
+    enum Kind
+    {
+        Drop,
+        Tine,
+        RandomDrops,
+        Stroke,
+        Rake
+    };
+    Kind kind = Drop;
+    float x = 0.0f, y = 0.0f, radius = 0.0f;
+    bool hasColor = false;
+    color clr;
+    float strength = 0.0f, sharpness = 0.0f;
+    int count = 0;
+    float minRadius = 0.0f, maxRadius = 0.0f;
+    std::vector<Vector2> points;
+    float angle = 0.0f, spacing = 0.0f;
+};
+
+struct SceneScript
+{
+    int width = 1024;
+    int height = 1024;
+    uint32_t seed = 1;
+    int paletteIndex = 0;
+    int vertices = 400;
+    int quality = 2;
+    Color background = {245, 245, 245, 255};
+    std::string output;
+    std::vector<ScriptCommand> commands;
+};
+
+// Parse `text`; on failure returns false with a "line N: ..." message.
+bool ParseSceneScript(const std::string& text, SceneScript& script, std::string& error);
+bool LoadSceneScript(const std::string& path, SceneScript& script, std::string& error);
+
+// Replay the script's commands into `scene` and resolve every drop.
+void BuildScene(const SceneScript& script, MarblingScene& scene);
+// Rasterize the scene's drops (committed outlines, paint order) on the CPU.
+void RenderScene(const MarblingScene& scene, Color background, CpuCanvas& canvas);
@@ -0,0 +1,137 @@
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+bool Overlaps(const Rectangle& a, const Rectangle& b)
+{
+    return a.x <= b.x + b.width && a.x + a.width >= b.x &&
+           a.y <= b.y + b.height && a.y + a.height >= b.y;
+}
+
+// Retired drops come in with negative width; drops marbled by a NaN or
+// infinite op come in with NaN bounds. Neither can be placed in a cell.
+bool Indexable(const Rectangle& box)
+{
+    return box.width >= 0.0f && box.height >= 0.0f && std::isfinite(box.x) && std::isfinite(box.y);
+}
+
+// Cell index of a coordinate already in cell units. Clamped in float first
+// so far-away or huge boxes cannot overflow int; NaN (which clamp passes
+// through) maps to cell 0.
+int CellIndex(float cell, float maxCell)
+{
+    cell = floorf(cell);
+    return std::isnan(cell) ? 0 : static_cast<int>(std::clamp(cell, 0.0f, maxCell));
+}
+} // namespace
+
+void SpatialGrid::CellRange(const Rectangle& area, int& x0, int& y0, int& x1, int& y1) const
+{
+    const float inv = 1.0f / cellSize;
+    const float maxX = static_cast<float>(columns - 1);
+    const float maxY = static_cast<float>(rows - 1);
+    x0 = CellIndex((area.x - domain.x) * inv, maxX);
+    y0 = CellIndex((area.y - domain.y) * inv, maxY);
+    x1 = CellIndex((area.x + area.width - domain.x) * inv, maxX);
+    y1 = CellIndex((area.y + area.height - domain.y) * inv, maxY);
+}
+
+void SpatialGrid::Build(Rectangle newDomain, float newCellSize, const std::vector<Rectangle>& newBoxes)
+{
+    domain = newDomain;
+    cellSize = std::max(newCellSize, 1.0f);
+    columns = std::max(1, static_cast<int>(ceilf(domain.width / cellSize)));
+    rows = std::max(1, static_cast<int>(ceilf(domain.height / cellSize)));
+    boxes = newBoxes;
+    boxCount = boxes.size();
+
+    // Counting pass, prefix sum, then fill: two walks over the boxes.
+    cellStart.assign(static_cast<size_t>(columns) * rows + 1, 0);
+    int x0, y0, x1, y1;
+    for (const Rectangle& box : boxes)
+    {
+        if (!Indexable(box))
+        {
+            continue;
+        }
+        CellRange(box, x0, y0, x1, y1);
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                ++cellStart[static_cast<size_t>(y) * columns + x + 1];
+            }
+        }
+    }
+    for (size_t i = 1; i < cellStart.size(); ++i)
+    {
+        cellStart[i] += cellStart[i - 1];
+    }
+    cellItems.resize(cellStart.back());
+    std::vector<uint32_t>& cursor = seen; // reused as fill cursors
+    cursor.assign(cellStart.begin(), cellStart.end() - 1);
+    for (size_t id = 0; id < boxes.size(); ++id)
+    {
+        const Rectangle& box = boxes[id];
+        if (!Indexable(box))
+        {
+            continue;
+        }
+        CellRange(box, x0, y0, x1, y1);
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                cellItems[cursor[static_cast<size_t>(y) * columns + x]++] = static_cast<uint32_t>(id);
+            }
+        }
+    }
+    seen.assign(boxes.size(), 0);
+    stamp = 0;
+}
+
+void SpatialGrid::Clear()
+{
+    columns = rows = 0;
+    boxCount = 0;
+    boxes.clear();
+    cellStart.clear();
+    cellItems.clear();
+    seen.clear();
+}
+
+void SpatialGrid::Query(Rectangle area, std::vector<uint32_t>& out) const
+{
+    out.clear();
+    if (++stamp == 0)
+    {
+        std::fill(seen.begin(), seen.end(), 0);
+        stamp = 1;
+    }
+    if (columns == 0)
+    {
+        return;
+    }
+    int x0, y0, x1, y1;
+    CellRange(area, x0, y0, x1, y1);
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            const size_t cell = static_cast<size_t>(y) * columns + x;
+            for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+            {
+                const uint32_t id = cellItems[i];
+                if (seen[id] != stamp && Overlaps(boxes[id], area))
+                {
+                    seen[id] = stamp;
+                    out.push_back(id);
+                }
+            }
+        }
+    }
+    std::sort(out.begin(), out.end());
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "raylib.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over axis-aligned boxes, rebuilt in bulk. Boxes are stored
+// in every cell they overlap (compressed row layout, so a rebuild does not
+// allocate once warmed up). Cell ranges are clamped to the domain for boxes
+// and queries alike, so geometry pushed off the canvas lands in the border
+// cells and is still found by any query that touches it.
+class SpatialGrid
+{
+public:
+    // Boxes with negative or NaN size or a non-finite corner are skipped;
+    // ids are box indices.
+    void Build(Rectangle domain, float cellSize, const std::vector<Rectangle>& boxes);
+    void Clear();
+
+    // Ids of all boxes overlapping `area`, sorted ascending and unique.
+    void Query(Rectangle area, std::vector<uint32_t>& out) const;
+
+    size_t IndexedCount() const { return boxCount; }
+
+private:
+    void CellRange(const Rectangle& area, int& x0, int& y0, int& x1, int& y1) const;
+
+    Rectangle domain{};
+    float cellSize = 64.0f;
+    int columns = 0;
+    int rows = 0;
+    size_t boxCount = 0;
+    std::vector<uint32_t> cellStart; // columns * rows + 1 prefix offsets
+    std::vector<uint32_t> cellItems;
+    std::vector<Rectangle> boxes;
+    // Per-id stamp used to de-duplicate boxes spanning several cells.
+    mutable std::vector<uint32_t> seen;
+    mutable uint32_t stamp = 0;
+};
@@ -0,0 +1,195 @@
+#include "triangulate.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Reflex-vertex grid resolution: about this many outline vertices per cell.
+constexpr float kVerticesPerCell = 8.0f;
+constexpr int kMaxGridSide = 256;
+
+// Twice the signed area of triangle (a, b, c).
+inline float Cross(const float* xs, const float* ys, uint32_t a, uint32_t b, uint32_t c)
+{
+    return (xs[b] - xs[a]) * (ys[c] - ys[a]) - (ys[b] - ys[a]) * (xs[c] - xs[a]);
+}
+
+// +1 or -1 depending on the outline's direction (shoelace sign).
+float Orientation(const float* xs, const float* ys, int n)
+{
+    double area2 = 0.0;
+    for (int i = 0, j = n - 1; i < n; j = i++)
+    {
+        area2 += (double)xs[j] * ys[i] - (double)xs[i] * ys[j];
+    }
+    return area2 >= 0.0 ? 1.0f : -1.0f;
+}
+} // namespace
+
+bool IsStarShapedFrom(const float* xs, const float* ys, int n, float cx, float cy)
+{
+    if (n < 3)
+        return false;
+    const float sign = Orientation(xs, ys, n);
+    for (int i = 0; i < n; ++i)
+    {
+        const int j = (i + 1) % n;
+        const float turn = (xs[i] - cx) * (ys[j] - cy) - (ys[i] - cy) * (xs[j] - cx);
+        // Zero-area fan triangles (repeated or collinear vertices) are harmless.
+        if (turn * sign < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void TriangulatePolygon(const float* xs, const float* ys, int n, std::vector<uint32_t>& triangles)
+{
+    triangles.clear();
+    if (n < 3)
+        return;
+    triangles.reserve(3 * (size_t)(n - 2));
+    const float sign = Orientation(xs, ys, n);
+
+    // Doubly linked ring of the vertices still in the polygon. Only reflex
+    // vertices can lie inside a candidate ear; they are bucketed on a coarse
+    // grid so an ear test only visits the ones near its triangle.
+    static thread_local std::vector<uint32_t> prev, next;
+    static thread_local std::vector<unsigned char> removed, reflex;
+    static thread_local std::vector<std::vector<uint32_t>> cells;
+    prev.resize(n);
+    next.resize(n);
+    removed.assign(n, 0);
+    reflex.assign(n, 0);
+    float minX = xs[0], maxX = xs[0], minY = ys[0], maxY = ys[0];
+    for (int i = 0; i < n; ++i)
+    {
+        prev[i] = (uint32_t)(i == 0 ? n - 1 : i - 1);
+        next[i] = (uint32_t)(i == n - 1 ? 0 : i + 1);
+        minX = fminf(minX, xs[i]);
+        maxX = fmaxf(maxX, xs[i]);
+        minY = fminf(minY, ys[i]);
+        maxY = fmaxf(maxY, ys[i]);
+    }
+    auto convexity = [&](uint32_t v)
+    { return Cross(xs, ys, prev[v], v, next[v]) * sign; };
+
+    // Roughly square cells, so long stretched bands get a long grid.
+    const float width = fmaxf(maxX - minX, 1e-3f);
+    const float height = fmaxf(maxY - minY, 1e-3f);
+    const float cellCount = fmaxf((float)n / kVerticesPerCell, 1.0f);
+    const int columns = std::clamp((int)sqrtf(cellCount * width / height), 1, kMaxGridSide);
+    const int rows = std::clamp((int)sqrtf(cellCount * height / width), 1, kMaxGridSide);
+    const float cellW = width / columns;
+    const float cellH = height / rows;
+    auto column = [&](float x)
+    { return std::clamp((int)((x - minX) / cellW), 0, columns - 1); };
+    auto row = [&](float y)
+    { return std::clamp((int)((y - minY) / cellH), 0, rows - 1); };
+    cells.resize((size_t)columns * rows);
+    for (std::vector<uint32_t>& cell : cells)
+        cell.clear();
+    auto addReflex = [&](uint32_t v)
+    {
+        reflex[v] = 1;
+        cells[(size_t)row(ys[v]) * columns + column(xs[v])].push_back(v);
+    };
+    for (int i = 0; i < n; ++i)
+    {
+        if (convexity((uint32_t)i) < 0.0f)
+            addReflex((uint32_t)i);
+    }
+
+    auto isEar = [&](uint32_t v)
+    {
+        if (reflex[v])
+            return false;
+        const uint32_t p = prev[v];
+        const uint32_t q = next[v];
+        const float x0 = fminf(xs[p], fminf(xs[v], xs[q]));
+        const float x1 = fmaxf(xs[p], fmaxf(xs[v], xs[q]));
+        const float y0 = fminf(ys[p], fminf(ys[v], ys[q]));
+        const float y1 = fmaxf(ys[p], fmaxf(ys[v], ys[q]));
+        const int c0 = column(x0), c1 = column(x1);
+        for (int cy = row(y0), r1 = row(y1); cy <= r1; ++cy)
+        {
+            for (int cx = c0; cx <= c1; ++cx)
+            {
+                for (const uint32_t r : cells[(size_t)cy * columns + cx])
+                {
+                    if (xs[r] <= x0 || xs[r] >= x1 || ys[r] <= y0 || ys[r] >= y1)
+                        continue;
+                    if (removed[r] || !reflex[r] || r == p || r == q)
+                        continue;
+                    if (Cross(xs, ys, p, v, r) * sign > 0.0f && Cross(xs, ys, v, q, r) * sign > 0.0f &&
+                        Cross(xs, ys, q, p, r) * sign > 0.0f)
+                        return false;
+                }
+            }
+        }
+        return true;
+    };
+    auto updateReflex = [&](uint32_t v)
+    {
+        // A vertex turning reflex again is simply bucketed a second time.
+        if (convexity(v) < 0.0f)
+        {
+            if (!reflex[v])
+                addReflex(v);
+        }
+        else
+        {
+            reflex[v] = 0;
+        }
+    };
+    auto clip = [&](uint32_t v)
+    {
+        const uint32_t p = prev[v];
+        const uint32_t q = next[v];
+        // Reverse of the outline direction, matching the fan.
+        triangles.push_back(q);
+        triangles.push_back(v);
+        triangles.push_back(p);
+        next[p] = q;
+        prev[q] = p;
+        removed[v] = 1;
+        updateReflex(p);
+        updateReflex(q);
+        return p;
+    };
+
+    uint32_t remaining = (uint32_t)n;
+    uint32_t v = 0;
+    uint32_t misses = 0;
+    while (remaining > 3)
+    {
+        if (isEar(v))
+        {
+            v = clip(v);
+            --remaining;
+            misses = 0;
+            continue;
+        }
+        v = next[v];
+        if (++misses < remaining)
+            continue;
+        // A full lap without an ear: the outline crosses itself somewhere.
+        uint32_t best = v;
+        float bestConvexity = convexity(v);
+        for (uint32_t u = next[v]; u != v; u = next[u])
+        {
+            const float c = convexity(u);
+            if (c > bestConvexity)
+            {
+                best = u;
+                bestConvexity = c;
+            }
+        }
+        v = clip(best);
+        --remaining;
+        misses = 0;
+    }
+    triangles.push_back(next[v]);
+    triangles.push_back(v);
+    triangles.push_back(prev[v]);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Filling drop outlines. A fan from the drop center is exact as long as the
+// outline is star-shaped around it; marbled drops quickly stop being so, and
+// the fan then overdraws some regions and leaves culled (back-facing) holes
+// in others. Outlines are structure-of-arrays streams of n vertices without
+// a repeated closing vertex.
+
+// True if every fan triangle (c, v[i], v[i+1]) has the outline's winding,
+// i.e. the fan from c covers the outline exactly once.
+bool IsStarShapedFrom(const float* xs, const float* ys, int n, float cx, float cy);
+
+// Ear-clipping triangulation of a simple polygon into n - 2 triangles
+// (vertex index triples), each listed against the outline's direction like
+// the fan in Drop::Draw_drops, so back-face culling treats both alike.
+// Slightly self-intersecting outlines still yield n - 2 triangles; the
+// clipper then takes the most convex remaining vertex when no ear is left.
+void TriangulatePolygon(const float* xs, const float* ys, int n, std::vector<uint32_t>& triangles);
@@ -0,0 +1,167 @@
+#include "warp_shader.h"
+
+#include <cmath>
+
+#if defined(__EMSCRIPTEN__)
+const char* const kWarpShaderHeader = "#version 100\n"
+                                      "#ifdef GL_FRAGMENT_PRECISION_HIGH\nprecision highp float;\n#else\nprecision mediump float;\n#endif\n"
+                                      "#define IN varying\n#define finalColor gl_FragColor\n#define TEXTURE texture2D\n";
+#else
+const char* const kWarpShaderHeader = "#version 330\n#define IN in\nout vec4 finalColor;\n#define TEXTURE texture\n";
+#endif
+
+const char* const kWarpShaderInverse = R"(
+float smoothUnit(float u)
+{
+    u = clamp(u, 0.0, 1.0);
+    return u * u * u * (u * (u * 6.0 - 15.0) + 10.0);
+}
+
+// (1 - S(u))^exponent. The quintic can overshoot 1 near u = 1 and pow of a
+// base <= 0 is undefined in GLSL, so the edge of the band is cut off before
+// the pow.
+float falloff(float u, float exponent)
+{
+    float w = 1.0 - smoothUnit(u);
+    return w > 0.0 ? pow(w, exponent) : 0.0;
+}
+
+// Pull p back through a tine segment from a to b. The push runs along the
+// segment, so the distance to its line is kept and only the coordinate
+// along it is solved for, with Newton steps (the map is monotone along the
+// segment, see MarbleOp).
+vec2 unsegment(vec2 p, vec2 a, vec2 b, float strength, float band, float exponent)
+{
+    vec2 ab = b - a;
+    float len = length(ab);
+    if (len < 1e-4)
+        return p;
+    vec2 m = ab / len;
+    vec2 rel = p - a;
+    float d = abs(rel.y * m.x - rel.x * m.y);
+    if (d >= band)
+        return p;
+    float push = strength * falloff(d / band, exponent);
+    float span = 2.0 * max(band, 1.5 * abs(strength));
+    float t = dot(rel, m);
+    float t0 = t;
+    for (int k = 0; k < 4; ++k)
+    {
+        float u0 = clamp((t0 + 0.5 * span) / span, 0.0, 1.0);
+        float u1 = clamp((t0 - len + 0.5 * span) / span, 0.0, 1.0);
+        float slope = 30.0 * (u0 * u0 * (u0 - 1.0) * (u0 - 1.0) - u1 * u1 * (u1 - 1.0) * (u1 - 1.0)) / span;
+        t0 -= (t0 + push * (smoothUnit(u0) - smoothUnit(u1)) - t) / (1.0 + push * slope);
+    }
+    return p + m * (t0 - t);
+}
+
+// Pull p back through a rake: comb is (first, spacing, tines, exponent).
+// Only the tines whose band covers p are visited.
+vec2 unrake(vec2 p, vec2 pull, float band, vec4 comb)
+{
+    vec2 axis = vec2(-pull.y, pull.x) / max(length(pull), 1e-6);
+    float u = dot(p, axis) - comb.x;
+    float kBegin = max(ceil((u - band) / comb.y), 0.0);
+    float kEnd = min(floor((u + band) / comb.y), comb.z - 1.0);
+    float sum = 0.0;
+    for (int k = 0; k < 64; ++k)
+    {
+        float tine = kBegin + float(k);
+        if (tine > kEnd)
+            break;
+        sum += falloff(abs(u - tine * comb.y) / band, comb.w);
+    }
+    return p - pull * sum;
+}
+
+bool unwarp(inout vec2 p, vec4 o, vec4 e)
+{
+    if (o.x > 2.5)
+    {
+        p = unrake(p, o.yz, o.w, e);
+    }
+    else if (o.x > 1.5)
+    {
+        p = unsegment(p, o.yz, e.xy, e.z, o.w, e.w);
+    }
+    else if (o.x < 0.5)
+    {
+        // Drop insertion moves distance m from the center to
+        // m + r^2 / (m + r); solve for m.
+        vec2 d = p - o.yz;
+        float M = length(d);
+        float r = o.w;
+        if (M < r)
+            return false;
+        float m = 0.5 * ((M - r) + sqrt(max(M * M + 2.0 * M * r - 3.0 * r * r, 0.0)));
+        p = o.yz + d * (m / max(M, 1e-4));
+    }
+    else
+    {
+        // A vertical shear with the band of Drop::applyVerticalTine, without
+        // the per-drop cap on the band.
+        float u = abs(p.x - o.y) / o.w;
+        if (u < 1.0)
+            p.y -= o.z * falloff(u, e.x);
+    }
+    return true;
+}
+)";
+
+void PackWarpOp(const MarbleOp& op, float* out)
+{
+    for (int k = 0; k < kWarpFloatsPerOp; ++k)
+    {
+        out[k] = 0.0f;
+    }
+    if (op.kind == MarbleOp::DropInsert)
+    {
+        out[0] = 0.0f;
+        out[1] = op.x;
+        out[2] = op.y;
+        out[3] = op.radius;
+        out[4] = static_cast<float>((op.rgba >> 24) & 0xFF) / 255.0f;
+        out[5] = static_cast<float>((op.rgba >> 16) & 0xFF) / 255.0f;
+        out[6] = static_cast<float>((op.rgba >> 8) & 0xFF) / 255.0f;
+        out[7] = static_cast<float>(op.rgba & 0xFF) / 255.0f;
+    }
+    else if (op.kind == MarbleOp::TineSegment)
+    {
+        out[0] = 2.0f;
+        out[1] = op.x;
+        out[2] = op.y;
+        out[3] = TineBand(op.sharpness);
+        out[4] = op.x1;
+        out[5] = op.y1;
+        out[6] = op.strength;
+        out[7] = TineExponent(op.sharpness);
+    }
+    else if (op.kind == MarbleOp::Rake)
+    {
+        // The shaders take the axis from the pull, which flips with the sign
+        // of the strength; the comb is symmetric about its center, so only
+        // the center's offset has to follow.
+        const float pullX = op.x1 * op.strength;
+        const float pullY = op.y1 * op.strength;
+        const float length = sqrtf(pullX * pullX + pullY * pullY);
+        const float axisX = length > 0.0f ? -pullY / length : 0.0f;
+        const float axisY = length > 0.0f ? pullX / length : 0.0f;
+        out[0] = 3.0f;
+        out[1] = pullX;
+        out[2] = pullY;
+        out[3] = TineBand(op.sharpness);
+        out[4] = op.x * axisX + op.y * axisY - 0.5f * op.spacing * static_cast<float>(op.tines - 1);
+        out[5] = op.spacing;
+        out[6] = static_cast<float>(op.tines);
+        out[7] = TineExponent(op.sharpness);
+    }
+    else
+    {
+        // Band and exponent as in Drop::applyVerticalTine.
+        out[0] = 1.0f;
+        out[1] = op.x;
+        out[2] = op.strength;
+        out[3] = TineBand(op.sharpness);
+        out[4] = TineExponent(op.sharpness);
+    }
+}
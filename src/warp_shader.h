@@ -0,0 +1,33 @@
+#pragma once
+
+#include "drops.h"
+#include "raylib.h"
+
+// Inverse marbling shared by the fragment shaders that pull pixels back
+// through recorded ops (BakedLayer and PixelEngine). Both walk ops newest
+// first, packed by PackWarpOp as two vec4s each:
+//
+//   drop insert     (0, x, y, radius)          (r, g, b, a)
+//   vertical tine   (1, x, strength, band)     (exponent, 0, 0, 0)
+//   tine segment    (2, x, y, band)            (x1, y1, strength, exponent)
+//   rake            (3, pullX, pullY, band)    (first, spacing, tines, exponent)
+//
+// A rake's pull is strength times direction; `first` is the offset of its
+// first tine along the axis perpendicular to the pull.
+//
+// A shader is assembled as kWarpShaderHeader, its own inputs, then
+// kWarpShaderInverse, then its main(), which calls
+// `bool unwarp(inout vec2 p, vec4 o, vec4 e)` per op. unwarp returns false
+// when p lies inside a drop the op inserted, where it has no preimage; the
+// caller decides what such a pixel shows and may leave `e` unset for drops.
+
+constexpr Color kWarpBackground = {245, 245, 245, 255}; // RAYWHITE
+constexpr int kWarpFloatsPerOp = 8;
+
+// Version, precision and the IN / finalColor / TEXTURE macros for the
+// platform's GLSL.
+extern const char* const kWarpShaderHeader;
+extern const char* const kWarpShaderInverse;
+
+// Write the kWarpFloatsPerOp floats the shaders read for `op` to `out`.
+void PackWarpOp(const MarbleOp& op, float* out);
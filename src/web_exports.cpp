@@ -32,6 +32,23 @@ extern "C"
         GetApp().ApplyTineAt(x, strength, sharpness);
     }
 
+    // Drag a tine along `count` points stored as x, y float pairs in the
+    // heap (canvas pixels).
+    void applyTineStroke(const float* points, int count, float strength, float sharpness)
+    {
+        if (!points || count < 2)
+        {
+            return;
+        }
+        static_assert(sizeof(Vector2) == 2 * sizeof(float), "points are read as Vector2");
+        GetApp().ApplyTineStroke(reinterpret_cast<const Vector2*>(points), static_cast<size_t>(count), strength, sharpness);
+    }
+
+    void applyRake(float x, float y, float angleDegrees, int tines, float spacing, float strength, float sharpness)
+    {
+        GetApp().ApplyRake(x, y, angleDegrees, tines, spacing, strength, sharpness);
+    }
+
     void setTineParams(float strength, float sharpness)
     {
         GetApp().SetTineParams(strength, sharpness);
@@ -47,6 +64,49 @@ extern "C"
         GetApp().SetNextDropColor(r, g, b, a);
     }
 
+    int pickDropAt(float x, float y)
+    {
+        return GetApp().PickDropAt(x, y);
+    }
+
+    // Add `count` drops in one call from DropRecord entries in the heap (16
+    // bytes each: f32 x, y, radius, u32 0xRRGGBBAA). Returns the number
+    // added.
+    int insertDrops(const DropRecord* records, int count)
+    {
+        if (!records || count <= 0)
+        {
+            return 0;
+        }
+        return static_cast<int>(GetApp().InsertDrops(records, static_cast<size_t>(count)));
+    }
+
+    // Step back or forward one action; 1 if the scene changed.
+    int undo(void)
+    {
+        return GetApp().Undo() ? 1 : 0;
+    }
+
+    int redo(void)
+    {
+        return GetApp().Redo() ? 1 : 0;
+    }
+
+    int canUndo(void)
+    {
+        return GetApp().CanUndo() ? 1 : 0;
+    }
+
+    int canRedo(void)
+    {
+        return GetApp().CanRedo() ? 1 : 0;
+    }
+
+    void setHistoryLimits(int levels, int megabytes)
+    {
+        GetApp().SetHistoryLimits(levels, megabytes);
+    }
+
     int getCurrentPaletteSize(void)
     {
         return GetApp().GetCurrentPaletteSize();
@@ -72,6 +132,16 @@ extern "C"
         return GetApp().GetQualityMode();
     }
 
+    void setRenderEngine(int engine)
+    {
+        GetApp().SetRenderEngine(engine);
+    }
+
+    int getRenderEngine(void)
+    {
+        return GetApp().GetRenderEngine();
+    }
+
     int getPaletteCount(void)
     {
         return GetApp().GetPaletteCount();
@@ -81,4 +151,64 @@ extern "C"
     {
         GetApp().SetPaletteIndex(index);
     }
+
+    // Session event log bytes, for saving from JS (HEAPU8 view of size bytes).
+    const unsigned char* getEventLogData(void)
+    {
+        return GetApp().GetEventLog().Bytes().data();
+    }
+
+    int getEventLogSize(void)
+    {
+        return static_cast<int>(GetApp().GetEventLog().Bytes().size());
+    }
+
+    // Frame timing summary: FrameStats::kRowCount rows (input, marble,
+    // deform, submit, present, whole frame) of p50, p95, p99 and latest, in
+    // milliseconds (HEAPF32 view of getFrameStatsSize() floats). Recomputed
+    // on every call.
+    const float* getFrameStats(void)
+    {
+        return GetApp().GetFrameStats().Summary();
+    }
+
+    int getFrameStatsSize(void)
+    {
+        return static_cast<int>(FrameStats::kRowCount * FrameStats::kColumnCount);
+    }
+
+    int getFrameStatsSamples(void)
+    {
+        return static_cast<int>(GetApp().GetFrameStats().SampleCount());
+    }
+
+    void setFrameStatsOverlay(int on)
+    {
+        GetApp().SetFrameStatsOverlay(on != 0);
+    }
+
+    void setFrameBudget(float milliseconds)
+    {
+        GetApp().SetFrameBudget(milliseconds);
+    }
+
+    int getDetailLevel(void)
+    {
+        return GetApp().GetDetailLevel();
+    }
+
+    void setCompactStorage(int on)
+    {
+        GetApp().SetCompactStorage(on != 0);
+    }
+
+    int getGeometryBytes(void)
+    {
+        return static_cast<int>(GetApp().GetGeometryBytes());
+    }
+
+    void setBakeLimits(int maxLiveDrops, float maxAgeSeconds)
+    {
+        GetApp().SetBakeLimits(maxLiveDrops, maxAgeSeconds);
+    }
 }
\ No newline at end of file
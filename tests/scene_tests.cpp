@@ -0,0 +1,511 @@
+// Regression tests for the scene model. Runs headless (no window or GL
+// context); exits non-zero if any check fails.
+//
+//   suminasashi_tests [filter]
+
+#include "event_log.h"
+#include "frame_budget.h"
+#include "scene.h"
+#include "spatial_grid.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+int failures = 0;
+
+#define EXPECT(condition, ...)                                              \
+    do                                                                      \
+    {                                                                       \
+        if (!(condition))                                                   \
+        {                                                                   \
+            ++failures;                                                     \
+            std::printf("  FAIL %s:%d: ", __FILE__, __LINE__);              \
+            std::printf(__VA_ARGS__);                                       \
+            std::printf("\n");                                              \
+        }                                                                   \
+    } while (0)
+
+// Number of drops with a non-finite vertex, center or bounds.
+size_t CountNonFinite(const MarblingScene& scene)
+{
+    size_t bad = 0;
+    for (size_t i = 0; i < scene.Drops().Size(); ++i)
+    {
+        const Drop& drop = scene.Drops()[i];
+        if (drop.isRetired())
+            continue;
+        const Rectangle b = drop.getBounds();
+        bool finite = std::isfinite(b.x) && std::isfinite(b.y) && std::isfinite(b.width) && std::isfinite(b.height);
+        const float* xs = drop.getCurX();
+        const float* ys = drop.getCurY();
+        for (int v = 0; v < drop.getVertexCount() && finite; ++v)
+            finite = std::isfinite(xs[v]) && std::isfinite(ys[v]);
+        bad += finite ? 0 : 1;
+    }
+    return bad;
+}
+
+// Short strokes through a field of drops, so the band edge of almost every
+// segment passes through some outline.
+void TestStrokeBandEdgeStaysFinite()
+{
+    MarblingScene scene;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> xs(0.0f, 800.0f);
+    std::uniform_real_distribution<float> ys(0.0f, 600.0f);
+    std::uniform_real_distribution<float> radii(10.0f, 60.0f);
+    for (int i = 0; i < 800; ++i)
+    {
+        scene.AddDrop(xs(rng), ys(rng), color(200, 80, 40, 255), radii(rng), 64);
+        if (i % 9 == 8)
+        {
+            const Vector2 points[2] = {{xs(rng), ys(rng)}, {xs(rng), ys(rng)}};
+            scene.AddTineStroke(points, 2, 24.0f, 18.0f);
+        }
+    }
+    scene.ResolveAll();
+    const size_t bad = CountNonFinite(scene);
+    EXPECT(bad == 0, "%zu of %zu drops have non-finite geometry", bad, scene.Drops().Size());
+}
+
+// A drop's state as undo, redo and replay must reproduce it.
+struct DropShape
+{
+    bool retired = false;
+    uint32_t rgba = 0;
+    std::vector<float> xs, ys;
+
+    bool operator==(const DropShape& other) const
+    {
+        return retired == other.retired && rgba == other.rgba && xs == other.xs && ys == other.ys;
+    }
+};
+
+std::vector<DropShape> Capture(const MarblingScene& scene)
+{
+    std::vector<DropShape> shapes(scene.Drops().Size());
+    for (size_t i = 0; i < shapes.size(); ++i)
+    {
+        const Drop& drop = scene.Drops()[i];
+        shapes[i].retired = drop.isRetired();
+        shapes[i].rgba = drop.getPackedColor();
+        if (!drop.isRetired())
+        {
+            shapes[i].xs.assign(drop.getCurX(), drop.getCurX() + drop.getVertexCount());
+            shapes[i].ys.assign(drop.getCurY(), drop.getCurY() + drop.getVertexCount());
+        }
+    }
+    return shapes;
+}
+
+// Mismatches between two captures, drop by drop and vertex by vertex.
+size_t CountMismatches(const std::vector<DropShape>& a, const std::vector<DropShape>& b, std::string& first)
+{
+    if (a.size() != b.size())
+    {
+        first = "drop count " + std::to_string(a.size()) + " vs " + std::to_string(b.size());
+        return 1;
+    }
+    size_t mismatches = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (!(a[i] == b[i]) && mismatches++ == 0)
+        {
+            first = "drop " + std::to_string(i) + " (" + std::to_string(a[i].xs.size()) + " vs " + std::to_string(b[i].xs.size()) + " vertices)";
+        }
+    }
+    return mismatches;
+}
+
+// Chords far longer than the edge limit once overflowed the insert count,
+// which then sized a reserve. Huge drops must stay within the budget.
+void TestHugeDropRemeshStaysInBudget()
+{
+    const RemeshParams params = RemeshParamsForQuality(1);
+    for (const double radius : {1.0e6, 1.0e10, 3.96e29})
+    {
+        MarblingScene scene;
+        scene.AddDrop(0.0f, 0.0f, color(200, 80, 40, 255), radius, 64);
+        scene.ResolveAll();
+        scene.RemeshRange(0, 1);
+        const int vertices = scene.Drops()[0].getVertexCount();
+        EXPECT(vertices >= 64 && vertices <= params.maxVertices, "radius %g remeshed to %d vertices", radius, vertices);
+    }
+}
+
+// A NaN tine strength turns the drops in its band into NaN outlines. The
+// next index rebuild must skip their boxes instead of writing cells for them.
+void TestNonFiniteBoxesStayOutOfIndex()
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    SpatialGrid grid;
+    const std::vector<Rectangle> boxes = {
+        {10.0f, 10.0f, 20.0f, 20.0f}, {nan, 10.0f, 20.0f, 20.0f}, {10.0f, 10.0f, nan, nan},
+        {-inf, 0.0f, 5.0f, 5.0f},     {40.0f, 40.0f, 10.0f, 10.0f},
+    };
+    grid.Build({0.0f, 0.0f, 256.0f, 256.0f}, 64.0f, boxes);
+    std::vector<uint32_t> found;
+    grid.Query({0.0f, 0.0f, 256.0f, 256.0f}, found);
+    EXPECT(found == std::vector<uint32_t>({0, 4}), "%zu boxes found, expected 2", found.size());
+    grid.Query({nan, 0.0f, 10.0f, 10.0f}, found);
+    EXPECT(found.empty(), "a NaN query found %zu boxes", found.size());
+
+    MarblingScene scene;
+    for (int i = 0; i < 40; ++i)
+        scene.AddDrop(40.0f + 15.0f * i, 200.0f + 5.0f * (i % 7), color(200, 80, 40, 255), 30.0, 64);
+    scene.AddTine(200.0f, nan, 20.0f);
+    std::vector<uint32_t> visible;
+    for (int pass = 0; pass < 2; ++pass)
+        scene.ResolveVisible({0.0f, 0.0f, 640.0f, 480.0f}, 0.05f, visible);
+    EXPECT(visible.size() <= scene.Drops().Size(), "%zu visible of %zu drops", visible.size(), scene.Drops().Size());
+}
+
+// A session driven the way the app drives it: a few inputs per frame, then
+// the visible drops resolved, with drops off screen falling behind and
+// catching up later. Remeshing and far-field marbling stay on, so the
+// geometry depends on where resolves happen; the replay must hit the same
+// points to match.
+void TestReplayMatchesLiveSession()
+{
+    constexpr float kMargin = 0.05f;
+    constexpr int kWidth = 640;
+    constexpr int kHeight = 480;
+    MarblingScene live;
+    EventLog log(11);
+    std::mt19937 rng(11);
+    // Inputs land on a canvas larger than the viewport.
+    std::uniform_real_distribution<float> xs(-200.0f, 900.0f);
+    std::uniform_real_distribution<float> ys(-200.0f, 700.0f);
+    std::uniform_real_distribution<float> radii(8.0f, 70.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<uint32_t> visible;
+    float time = 0.0f;
+    for (int frame = 0; frame < 400; ++frame)
+    {
+        time += 1.0f / 60.0f;
+        const int inputs = static_cast<int>(unit(rng) * 4.0f);
+        for (int k = 0; k < inputs; ++k)
+        {
+            SceneEvent event;
+            event.time = time;
+            const float pick = unit(rng);
+            if (pick < 0.7f)
+            {
+                event.type = SceneEvent::Drop;
+                event.x = xs(rng);
+                event.y = ys(rng);
+                event.radius = radii(rng);
+                event.vertices = 96;
+                event.rgba = 0x3060C0FF;
+                live.AddDrop(event.x, event.y, UnpackColor(event.rgba), event.radius, event.vertices);
+            }
+            else if (pick < 0.8f)
+            {
+                event.type = SceneEvent::Tine;
+                event.x = xs(rng);
+                event.strength = 40.0f;
+                event.sharpness = 24.0f;
+                live.AddTine(event.x, event.strength, event.sharpness);
+            }
+            else if (pick < 0.9f)
+            {
+                event.type = SceneEvent::TineSegment;
+                event.x = xs(rng);
+                event.y = ys(rng);
+                event.x1 = event.x + 120.0f * (unit(rng) - 0.5f);
+                event.y1 = event.y + 120.0f * (unit(rng) - 0.5f);
+                event.strength = 30.0f;
+                event.sharpness = 20.0f;
+                const Vector2 points[2] = {{event.x, event.y}, {event.x1, event.y1}};
+                live.AddTineStroke(points, 2, event.strength, event.sharpness);
+            }
+            else
+            {
+                event.type = SceneEvent::Rake;
+                event.x = xs(rng);
+                event.y = ys(rng);
+                event.angle = 360.0f * unit(rng);
+                event.tines = 6;
+                event.spacing = 30.0f;
+                event.strength = 35.0f;
+                event.sharpness = 16.0f;
+                live.AddRake(event.x, event.y, event.angle, event.tines, event.spacing, event.strength, event.sharpness);
+            }
+            log.Append(event);
+        }
+
+        SceneEvent point;
+        point.time = time;
+        // The frame budget steps detail down, then partly back up.
+        if (frame == 120 || frame == 260)
+        {
+            point.type = SceneEvent::Detail;
+            point.level = frame == 120 ? 2 : 1;
+            live.SetRemeshParams(
+                ScaleRemeshDetail(RemeshParamsForQuality(1), FrameBudgetController::DetailForLevel(point.level)));
+            log.Append(point);
+        }
+        if (frame % 50 == 25)
+        {
+            point.type = SceneEvent::Pick;
+            point.x = xs(rng);
+            point.y = ys(rng);
+            live.PickDrop(point.x, point.y);
+            log.AppendIfChanged(point);
+        }
+        if (frame % 40 == 39)
+        {
+            point.type = SceneEvent::Remesh;
+            point.first = static_cast<uint32_t>(frame) % 64;
+            point.count = 64;
+            live.RemeshRange(point.first, point.count);
+            log.AppendIfChanged(point);
+        }
+        live.ResolveVisible({0.0f, 0.0f, static_cast<float>(kWidth), static_cast<float>(kHeight)}, kMargin, visible);
+        point.type = SceneEvent::Resolve;
+        point.width = kWidth;
+        point.height = kHeight;
+        point.margin = kMargin;
+        log.AppendIfChanged(point);
+    }
+    live.ResolveAll();
+
+    EventLog saved;
+    EXPECT(saved.Load(log.Bytes().data(), log.Bytes().size()), "log does not load back");
+    MarblingScene replayed;
+    ReplayEvents(saved.Events(), replayed);
+    std::string first;
+    const size_t mismatches = CountMismatches(Capture(live), Capture(replayed), first);
+    EXPECT(mismatches == 0, "%zu of %zu drops differ, first: %s", mismatches, live.Drops().Size(), first.c_str());
+}
+
+// Damaged logs must fail to load rather than crash the replay: records cut
+// short, values the app never records, and random byte flips.
+void TestCorruptLogIsRejected()
+{
+    EventLog good(3);
+    SceneEvent event;
+    event.type = SceneEvent::Viewport;
+    event.width = 640;
+    event.height = 480;
+    good.Append(event);
+    for (int i = 0; i < 6; ++i)
+    {
+        event = SceneEvent();
+        event.type = SceneEvent::Drop;
+        event.x = 100.0f + 60.0f * i;
+        event.y = 200.0f;
+        event.radius = 40.0f;
+        event.vertices = 64;
+        event.rgba = 0x3060C0FF;
+        good.Append(event);
+    }
+    event = SceneEvent();
+    event.type = SceneEvent::Rake;
+    event.x = 300.0f;
+    event.y = 200.0f;
+    event.angle = 30.0f;
+    event.tines = 4;
+    event.spacing = 30.0f;
+    event.strength = 35.0f;
+    event.sharpness = 16.0f;
+    good.Append(event);
+    event = SceneEvent();
+    event.type = SceneEvent::Resolve;
+    event.width = 640;
+    event.height = 480;
+    event.margin = 0.05f;
+    good.Append(event);
+    const std::vector<uint8_t> bytes = good.Bytes();
+
+    EventLog log;
+    EXPECT(log.Load(bytes.data(), bytes.size()), "the intact log does not load");
+    EXPECT(!log.Load(bytes.data(), bytes.size() - 1), "a truncated log loads");
+    EXPECT(log.EventCount() == good.EventCount(), "a failed load changed the log");
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<SceneEvent> bad(6);
+    bad[0].type = SceneEvent::Resolve;
+    bad[0].margin = nan;
+    bad[1].type = SceneEvent::Drop;
+    bad[1].radius = 3.96e29f;
+    bad[1].vertices = 64;
+    bad[2].type = SceneEvent::Drop;
+    bad[2].radius = 20.0f;
+    bad[2].vertices = 2;
+    bad[3].type = SceneEvent::Tine;
+    bad[3].strength = inf;
+    bad[4].type = SceneEvent::Rake;
+    bad[4].tines = 3;
+    bad[4].spacing = 20.0f;
+    bad[4].angle = nan;
+    bad[5].type = SceneEvent::TineSegment;
+    bad[5].x1 = nan;
+    for (const SceneEvent& record : bad)
+    {
+        EventLog damaged = good;
+        damaged.Append(record);
+        EXPECT(!log.Load(damaged.Bytes().data(), damaged.Bytes().size()), "record type %d with a bad value loads",
+               static_cast<int>(record.type));
+    }
+
+    // Whatever still loads after a byte flip must replay cleanly.
+    size_t loaded = 0;
+    for (size_t at = 0; at < bytes.size(); ++at)
+    {
+        for (const uint8_t mask : {0x01, 0x40, 0x80, 0xFF})
+        {
+            std::vector<uint8_t> flipped = bytes;
+            flipped[at] ^= mask;
+            if (!log.Load(flipped.data(), flipped.size()))
+                continue;
+            ++loaded;
+            MarblingScene scene;
+            ReplayEvents(log.Events(), scene);
+        }
+    }
+    EXPECT(loaded > 0, "no flipped log loads, so the replay check ran on nothing");
+}
+
+// One undoable action: drops (sometimes a small drop right under a big one,
+// which occlusion culling retires), a tine, a rake or a tine stroke.
+void RandomAction(MarblingScene& scene, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> xs(0.0f, 800.0f);
+    std::uniform_real_distribution<float> ys(0.0f, 600.0f);
+    std::uniform_real_distribution<float> radii(15.0f, 50.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float pick = unit(rng);
+    if (pick < 0.6f || scene.Drops().Size() < 5)
+    {
+        const float x = xs(rng);
+        const float y = ys(rng);
+        if (pick < 0.2f)
+        {
+            scene.AddDrop(x, y, color(20, 30, 200, 255), 2.0, 16);
+            scene.AddDrop(x, y, color(200, 30, 30, 255), 60.0, 64);
+        }
+        else
+        {
+            scene.AddDrop(x, y, color(200, 30, 30, 255), radii(rng), 64);
+        }
+    }
+    else if (pick < 0.75f)
+    {
+        scene.AddTine(xs(rng), 30.0f, 20.0f);
+    }
+    else if (pick < 0.9f)
+    {
+        scene.AddRake(xs(rng), ys(rng), 90.0f, 8, 40.0f, 25.0f, 12.0f);
+    }
+    else
+    {
+        const Vector2 points[4] = {{xs(rng), ys(rng)}, {xs(rng), ys(rng)}, {xs(rng), ys(rng)}, {xs(rng), ys(rng)}};
+        scene.AddTineStroke(points, 4, 30.0f, 16.0f);
+    }
+}
+
+// History copies a drop just before an action first changes it. Undoing
+// every action must give back the geometry recorded before it, bit for bit,
+// and redoing must give back the geometry after it, in both storage
+// layouts. RemeshRange resamples outside any action and saves no copies: it
+// only reaches drops that have resolved every op, and those were copied
+// when they resolved the action's ops. An undo across it therefore returns
+// to the geometry before the action, and a redo to the remeshed scene.
+void TestUndoRedoRoundTrip()
+{
+    for (const bool compact : {false, true})
+    {
+        MarblingScene scene;
+        scene.Drops().SetCompact(compact);
+        std::mt19937 rng(7);
+        std::vector<uint32_t> visible;
+        auto settle = [&]()
+        {
+            scene.ResolveVisible({-200.0f, -200.0f, 1200.0f, 1000.0f}, 0.05f, visible);
+            scene.ResolveAll();
+        };
+        std::vector<std::vector<DropShape>> steps = {Capture(scene)};
+        for (int i = 0; i < 40; ++i)
+        {
+            scene.Checkpoint();
+            RandomAction(scene, rng);
+            settle();
+            steps.push_back(Capture(scene));
+        }
+        const char* layout = compact ? "compact" : "full";
+        std::string first;
+        for (size_t at = steps.size() - 1; at > 0; --at)
+        {
+            EXPECT(scene.Undo(), "%s: undo to step %zu refused", layout, at - 1);
+            settle();
+            const size_t mismatches = CountMismatches(Capture(scene), steps[at - 1], first);
+            EXPECT(mismatches == 0, "%s: undo to step %zu: %zu drops differ, first: %s", layout, at - 1, mismatches, first.c_str());
+        }
+        EXPECT(!scene.Undo(), "%s: undo past the first action", layout);
+        for (size_t at = 1; at < steps.size(); ++at)
+        {
+            EXPECT(scene.Redo(), "%s: redo to step %zu refused", layout, at);
+            settle();
+            const size_t mismatches = CountMismatches(Capture(scene), steps[at], first);
+            EXPECT(mismatches == 0, "%s: redo to step %zu: %zu drops differ, first: %s", layout, at, mismatches, first.c_str());
+        }
+        EXPECT(!scene.CanRedo(), "%s: redo past the last action", layout);
+
+        // One more action, then every drop is resampled at half detail.
+        const std::vector<DropShape> before = Capture(scene);
+        scene.Checkpoint();
+        scene.AddTine(150.0f, 30.0f, 20.0f);
+        settle();
+        scene.SetRemeshParams(ScaleRemeshDetail(scene.GetRemeshParams(), 0.5f));
+        EXPECT(scene.RemeshRange(0, scene.Drops().Size()), "%s: coarser params changed no outline", layout);
+        const std::vector<DropShape> remeshed = Capture(scene);
+        EXPECT(scene.Undo(), "%s: undo across RemeshRange refused", layout);
+        settle();
+        size_t mismatches = CountMismatches(Capture(scene), before, first);
+        EXPECT(mismatches == 0, "%s: undo across RemeshRange: %zu drops differ, first: %s", layout, mismatches, first.c_str());
+        EXPECT(scene.Redo(), "%s: redo across RemeshRange refused", layout);
+        settle();
+        mismatches = CountMismatches(Capture(scene), remeshed, first);
+        EXPECT(mismatches == 0, "%s: redo across RemeshRange: %zu drops differ, first: %s", layout, mismatches, first.c_str());
+    }
+}
+
+struct Test
+{
+    const char* name;
+    void (*run)();
+};
+
+const Test kTests[] = {
+    {"stroke_band_edge_stays_finite", TestStrokeBandEdgeStaysFinite},
+    {"huge_drop_remesh_stays_in_budget", TestHugeDropRemeshStaysInBudget},
+    {"non_finite_boxes_stay_out_of_index", TestNonFiniteBoxesStayOutOfIndex},
+    {"replay_matches_live_session", TestReplayMatchesLiveSession},
+    {"corrupt_log_is_rejected", TestCorruptLogIsRejected},
+    {"undo_redo_round_trip", TestUndoRedoRoundTrip},
+};
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    for (const Test& test : kTests)
+    {
+        if (filter && !std::strstr(test.name, filter))
+            continue;
+        const int before = failures;
+        test.run();
+        std::printf("%s %s\n", failures == before ? "ok  " : "FAIL", test.name);
+    }
+    return failures == 0 ? 0 : 1;
+}